@@ -0,0 +1,121 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Peak resident memory of the tangent assembly (paramOut 2) for each
+// assembly strategy, on a generated tetrahedra block, against the memory it
+// needs: the tangent matrix (the previous one is alive while the next one is
+// built), its values array, the forces vectors and, for the partial buffers
+// strategy, the buffers of the parts (see computePartRanges). The growth of
+// the peak resident set over the resident set before the assembly is
+// measured resetting the peak of the process (/proc/self/clear_refs, Linux).
+// Returns 1 when the growth is more than twice the needed memory plus 8 MB,
+// which guards against work buffers sized by the elements and not by the
+// pattern (e.g. 576 triplets per element, about 14 kB per element).
+//
+// usage (from src, after make bench):
+//   ./assemblyPeakMemory.lnx [nx ny nz] [nParts]
+
+#include "benchMesh.h"
+#include <fstream>
+#include <string>
+
+using namespace std  ;
+using namespace arma ;
+
+// resident set and its peak, in bytes, from /proc/self/status
+static bool residentSet( double & current, double & peak ){
+  ifstream status( "/proc/self/status" ) ;
+  string line ;
+  current = -1 ;  peak = -1 ;
+  while ( getline( status, line ) ){
+    if ( line.compare( 0, 6, "VmRSS:" ) == 0 ){ current = 1024.0 * atof( line.c_str() + 6 ) ; }
+    if ( line.compare( 0, 6, "VmHWM:" ) == 0 ){ peak    = 1024.0 * atof( line.c_str() + 6 ) ; }
+  }
+  return current >= 0 && peak >= 0 ;
+}
+
+// sets the peak of the resident set to the current resident set
+static bool resetPeak(){
+  ofstream clearRefs( "/proc/self/clear_refs" ) ;
+  clearRefs << "5" ;
+  clearRefs.close() ;
+  return !clearRefs.fail() ;
+}
+
+int main( int argc, char * argv[] ){
+
+  int nx = 40, ny = 10, nz = 10, nParts = 8 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ nParts = atoi( argv[4] ) ; }
+
+  modelData model ;  assemblyData assembly ;
+  generateTetraBlockModel( nx, ny, nz, model, assembly ) ;
+  assembly.nParts = nParts ;
+  computePartRanges( model, assembly ) ;
+
+  vec Ut( model.dofsPerNode*model.nNodes, fill::zeros ) ;
+  for ( uword i=0; i < model.redDofs.n_elem; i++){
+    Ut( model.redDofs( i ) ) = 1e-3 * sin( 0.01 * i ) ;
+  }
+
+  double nnz = assembly.rowInds.n_elem, nRed = model.neumdofs.n_elem ;
+  double matrixBytes = 16.0 * nnz + 8.0 * ( nRed + 1 ) ;
+  double forcesBytes = 3 * 8.0 * Ut.n_elem ;
+  double buffersBytes = 0 ;
+  for ( uword part=0; part < assembly.partRanges.n_cols; part++){
+    buffersBytes += 8.0 * ( assembly.partRanges( 1, part ) - assembly.partRanges( 0, part ) \
+                          + assembly.partRanges( 3, part ) - assembly.partRanges( 2, part ) ) ;
+  }
+
+  printf( "elements: %u | free dofs: %u | nnz: %u | tangent matrix %.2f MB | part buffers %.2f MB" \
+    " (%.2f MB covering all the entries)\n", model.nElems, (uint) nRed, (uint) nnz, \
+    matrixBytes / 1e6, buffersBytes / 1e6, nParts * 8.0 * ( Ut.n_elem + nnz ) / 1e6 ) ;
+  printf( "strategy         needed (MB)  peak growth (MB)  bytes/element\n" ) ;
+
+  const char * names[3] = { "serial", "coloring", "partial buffers" } ;
+  bool ok = true ;
+  for ( uint strategy=0; strategy <= 2; strategy++){
+    assembly.strategy = strategy ;
+    double needed = 2 * matrixBytes + 8.0 * nnz + forcesBytes \
+      + ( strategy == 2 ? buffersBytes : 0 ) ;
+
+    field<vec> fs(3,1) ;  field<sp_mat> ks(3,1) ;
+    assembler( model, assembly, Ut, Ut, Ut, 2, fs, ks ) ; // buffers of the outputs
+
+    double before, peak ;
+    if ( !resetPeak() || !residentSet( before, peak ) ){
+      cout << "the peak resident set can not be measured in this system" << endl ;
+      return 0 ;
+    }
+    for ( int rep=0; rep < 3; rep++){
+      assembler( model, assembly, Ut, Ut, Ut, 2, fs, ks ) ;
+    }
+    double after ;
+    residentSet( after, peak ) ;
+
+    double growth = peak - before ;
+    if ( growth > 2 * needed + 8e6 ){ ok = false ; }
+    printf( "%-15s %12.2f %17.2f %14.1f\n", names[strategy], needed / 1e6, growth / 1e6, \
+      growth / model.nElems ) ;
+  }
+
+  if ( !ok ){
+    cout << "the peak memory of the assembly is above the memory it needs" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
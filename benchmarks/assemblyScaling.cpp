@@ -0,0 +1,96 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Scaling of the tangent assembly (paramOut 2) from 1 to N threads for each
+// assembly strategy, on a generated tetrahedra block. For each strategy it
+// also checks that the results are bitwise equal for all thread counts.
+//
+// usage (from src, after make bench):
+//   ./assemblyScaling.lnx [nx ny nz] [maxThreads] [nReps]
+
+#include "benchMesh.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std  ;
+using namespace arma ;
+
+int main( int argc, char * argv[] ){
+
+  int nx = 20, ny = 10, nz = 10, maxThreads = 1, nReps = 3 ;
+#ifdef _OPENMP
+  maxThreads = omp_get_max_threads() ;
+#endif
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ maxThreads = atoi( argv[4] ) ; }
+  if ( argc >= 6 ){ nReps      = atoi( argv[5] ) ; }
+
+  modelData model ;  assemblyData assembly ;
+  generateTetraBlockModel( nx, ny, nz, model, assembly ) ;
+  const uvec & redDofs = model.redDofs ;
+
+  // smooth bending-like displacement field, so that the kernels do the work
+  // of a Newton iteration
+  vec Ut( model.dofsPerNode*model.nNodes, fill::zeros ) ;
+  for ( uint i=0; i < redDofs.n_elem; i++){
+    Ut( redDofs( i ) ) = 1e-3 * sin( 0.01 * i ) ;
+  }
+
+  cout << "elements: " << model.nElems << " | free dofs: " << model.neumdofs.n_elem \
+       << " | nnz: " << assembly.rowInds.n_elem << " | colors: " \
+       << assembly.colorPtrs.n_elem-1 << endl ;
+  cout << "strategy       threads  time/assembly (s)  speedup  bitwise equal" << endl ;
+
+  const char * names[3] = { "serial", "coloring", "partial buffers" } ;
+  double serialTime = 0 ;
+  wall_clock timer ;
+
+  for ( uint strategy=0; strategy <= 2; strategy++){
+    assembly.strategy = strategy ;
+    assembly.nParts   = max( 8, maxThreads ) ;
+    computePartRanges( model, assembly ) ;
+    vec FintRef, valsRef ;
+
+    for ( int nThreads=1; nThreads <= ( strategy == 0 ? 1 : maxThreads ); nThreads++){
+#ifdef _OPENMP
+      omp_set_num_threads( nThreads ) ;
+#endif
+      field<vec> fs(3,1) ;  field<sp_mat> ks(3,1) ;
+      timer.tic() ;
+      for ( int rep=0; rep < nReps; rep++){
+        assembler( model, assembly, Ut, Ut, Ut, 2, fs, ks ) ;
+      }
+      double time = timer.toc() / nReps ;
+      if ( strategy == 0 ){ serialTime = time ; }
+
+      vec vals = nonzeros( ks(0,0) ) ;
+      bool equal = true ;
+      if ( nThreads == 1 ){
+        FintRef = fs(0,0) ;  valsRef = vals ;
+      }else{
+        equal = ( vals.n_elem == valsRef.n_elem ) \
+          && ( memcmp( vals.memptr(), valsRef.memptr(), vals.n_elem*sizeof(double) ) == 0 ) \
+          && ( memcmp( fs(0,0).memptr(), FintRef.memptr(), FintRef.n_elem*sizeof(double) ) == 0 ) ;
+      }
+      printf( "%-15s %7i  %17.4f  %7.2f  %s\n", names[strategy], nThreads, time, \
+        serialTime / time, equal ? "yes" : "NO" ) ;
+    }
+  }
+  return 0 ;
+}
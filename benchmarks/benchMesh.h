@@ -0,0 +1,142 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// generated tetrahedra meshes for the benchmarks
+
+#ifndef BENCHMESH_H
+#define BENCHMESH_H
+
+#include "onsaspp.h"
+
+// =============================================================================
+// generateTetraBlockMesh
+// =============================================================================
+// block of nx*ny*nz hexahedra of size 4 x 1 x 1, each one split in six
+// tetrahedra, with the same matrices ONSAS writes for the solver: a SVK
+// material (E = 1000, nu = 0.3), tetrahedra with analytic constitutive
+// matrix, the nodes at x = 0 clamped and a unit load in z at x = 4.
+void generateTetraBlockMesh( int nx, int ny, int nz, arma::imat & conec, \
+  arma::mat & coordsElemsMat, arma::mat & materialsParamsMat, \
+  arma::mat & elementsParamsMat, arma::uvec & neumdofs, arma::vec & variableFext ){
+
+  int nNodes = (nx+1)*(ny+1)*(nz+1) ;
+  arma::mat nodesCoords( nNodes, 3 ) ;
+  for ( int k=0; k<=nz; k++){
+    for ( int j=0; j<=ny; j++){
+      for ( int i=0; i<=nx; i++){
+        int node = i + (nx+1)*( j + (ny+1)*k ) ;
+        nodesCoords( node, 0 ) = 4.0 * i / nx ;
+        nodesCoords( node, 1 ) = 1.0 * j / ny ;
+        nodesCoords( node, 2 ) = 1.0 * k / nz ;
+      }
+    }
+  }
+
+  const int tetsOfHexa[6][4] = { {0,1,3,7}, {0,1,7,4}, {1,7,4,5}, \
+                                 {1,2,3,7}, {1,7,2,6}, {1,5,6,7} } ;
+
+  conec.zeros( 6*nx*ny*nz, 8 ) ;
+  coordsElemsMat.zeros( 6*nx*ny*nz, 24 ) ;
+  int elem = 0 ;
+  for ( int k=0; k<nz; k++){
+    for ( int j=0; j<ny; j++){
+      for ( int i=0; i<nx; i++){
+        int hexaNodes[8] ;
+        for ( int c=0; c<8; c++){
+          int ic = i + ( (c==1) || (c==2) || (c==5) || (c==6) ) ;
+          int jc = j + ( (c==2) || (c==3) || (c==6) || (c==7) ) ;
+          int kc = k + ( c >= 4 ) ;
+          hexaNodes[c] = ic + (nx+1)*( jc + (ny+1)*kc ) ;
+        }
+        for ( int t=0; t<6; t++){
+          int tet[4] ;
+          for ( int a=0; a<4; a++){ tet[a] = hexaNodes[ tetsOfHexa[t][a] ] ; }
+
+          // positive jacobian for the ordering of shapeFunsDeriv
+          arma::mat jac( 3, 3 ) ;
+          for ( int d=0; d<3; d++){
+            jac( d, 0 ) = nodesCoords( tet[0], d ) - nodesCoords( tet[1], d ) ;
+            jac( d, 1 ) = nodesCoords( tet[3], d ) - nodesCoords( tet[1], d ) ;
+            jac( d, 2 ) = nodesCoords( tet[2], d ) - nodesCoords( tet[1], d ) ;
+          }
+          if ( arma::det( jac ) < 0 ){ std::swap( tet[2], tet[3] ) ; }
+
+          for ( int a=0; a<4; a++){
+            conec( elem, a ) = tet[a] + 1 ;
+            for ( int d=0; d<3; d++){
+              coordsElemsMat( elem, 6*a + 2*d ) = nodesCoords( tet[a], d ) ;
+            }
+          }
+          conec( elem, 4 ) = 1 ;  conec( elem, 5 ) = 1 ;
+          elem++ ;
+        }
+      }
+    }
+  }
+
+  materialsParamsMat = { { 0, 2, 1000, 0.3 } } ;
+  elementsParamsMat  = { { 4, 2 } } ;
+
+  std::vector<arma::uword> freeDofs ;
+  variableFext.zeros( 6*nNodes ) ;
+  for ( int node=0; node<nNodes; node++){
+    if ( nodesCoords( node, 0 ) > 0 ){
+      freeDofs.push_back( 6*node + 1 ) ;
+      freeDofs.push_back( 6*node + 3 ) ;
+      freeDofs.push_back( 6*node + 5 ) ;
+    }
+    if ( nodesCoords( node, 0 ) == 4.0 ){
+      variableFext( 6*node + 4 ) = 1.0 / ( (ny+1)*(nz+1) ) ;
+    }
+  }
+  neumdofs = arma::conv_to<arma::uvec>::from( freeDofs ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// generateTetraBlockModel
+// =============================================================================
+// model and assembly data of generateTetraBlockMesh as built by the solver
+// driver, with a full Newton, single load step method (load factor 1).
+void generateTetraBlockModel( int nx, int ny, int nz, modelData & model, \
+  assemblyData & assembly ){
+
+  arma::imat conec ;  arma::mat coordsElemsMat ;  arma::uvec neumdofs ;
+  arma::vec  variableFext ;
+  generateTetraBlockMesh( nx, ny, nz, conec, coordsElemsMat, \
+    model.materialsParamsMat, model.elementsParamsMat, neumdofs, variableFext ) ;
+
+  unsigned int nNodes = (nx+1)*(ny+1)*(nz+1) ;
+  model.numericalMethodParams = { 1, 1e-8, 1e-8, 30, 1, 1 } ;
+
+  computeModelData( conec, coordsElemsMat, model.elementsParamsMat, nNodes, model ) ;
+  computeDofsNumbering( neumdofs, true, model ) ;
+  dofsOnsasToModel( model, variableFext, model.variableFext ) ;
+  model.constantFext.zeros( model.variableFext.n_elem ) ;
+
+  computeElemGeometry( model, assembly.elemFunders, assembly.elemVols ) ;
+  computeSparsityPattern( model, model.dofsMap, model.neumdofs.n_elem, \
+    assembly.colPtrs, assembly.rowInds, assembly.elemSlots ) ;
+  computeElemColors( model, assembly.colorPtrs, assembly.colorElems, \
+    assembly.colorGroups ) ;
+}
+// =============================================================================
+
+#endif
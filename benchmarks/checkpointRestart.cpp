@@ -0,0 +1,128 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Checkpoint and restart of a solver session on a generated tetrahedra
+// block, with nSteps load steps: a session solves all of them, writing a
+// checkpoint (see sessionCheckpoint) after step nSteps/2, and a second
+// session restarts from it and solves the remaining ones. Reports the time
+// of the setup with and without the checkpoint and of the checkpoint copy,
+// and returns 1 when the results of the restart are not the same bits as
+// the ones of the first session.
+//
+// usage (from src, after make bench):
+//   ./checkpointRestart.lnx [nx ny nz] [nSteps]
+
+#include "benchMesh.h"
+
+#include <cstdio>
+
+using namespace std  ;
+using namespace arma ;
+
+// session of the block with the settings of the LDL' solver and symmetric
+// storage, restarted from path when restart is 1
+static void blockSession( int nx, int ny, int nz, int nSteps, uint restart, \
+  const string & path, solverSession & session ){
+
+  imat conec ;  mat coordsElemsMat ;  uvec neumdofs ;  vec variableFext ;
+  generateTetraBlockMesh( nx, ny, nz, conec, coordsElemsMat, \
+    session.model.materialsParamsMat, session.model.elementsParamsMat, neumdofs, variableFext ) ;
+  session.model.numericalMethodParams = { 1, 1e-8, 1e-8, 30, 1, double( nSteps ) } ;
+
+  // without console output and increments log
+  vec cppSolverParams = { 1, 8, 1, 1, 1, 2, 0, 1000, 0, 0, 1, 1, 1, 0, 0, \
+                          double( restart ), 0, 0, 0, 0 } ;
+  vec constantFext( variableFext.n_elem, fill::zeros ) ;
+  sessionSetup( conec, coordsElemsMat, neumdofs, constantFext, variableFext, \
+    cppSolverParams, path, session ) ;
+}
+
+int main( int argc, char * argv[] ){
+
+  int nx = 16, ny = 4, nz = 4, nSteps = 4 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ nSteps = max( 2, atoi( argv[4] ) ) ; }
+  uint checkpointIndex = 1 + nSteps/2 ;
+  const string path = "checkpointRestart.bin" ;
+  remove( path.c_str() ) ;
+
+  wall_clock timer ;
+
+  // first session: all the steps, with the checkpoint of step checkpointIndex
+  solverSession first ;
+  timer.tic() ;
+  blockSession( nx, ny, nz, nSteps, 0, path, first ) ;
+  double setupTime = timer.toc() ;
+
+  vec U( 6*first.model.nNodes, fill::zeros ), Udot = U, Udotdot = U ;
+  vec Ut, Utp1, Udottp1, Udotdottp1, auxOutValsVec, Ufirst ;
+  double currLoadFactor = 0, nextLoadFactor = 1.0 / nSteps, currTime = 0 ;
+  uint timeIndex = 1 ;
+  sessionCheckpointData checkpoint ;
+  double checkpointTime = 0 ;
+  for ( int step=0; step < nSteps; step++){
+    sessionTimeStep( U, Udot, Udotdot, currLoadFactor, nextLoadFactor, currTime, \
+      timeIndex, first, Ut, Utp1, Udottp1, Udotdottp1, auxOutValsVec ) ;
+    U = Utp1 ;  Udot = Udottp1 ;  Udotdot = Udotdottp1 ;
+    currTime = auxOutValsVec(0) ;  currLoadFactor = nextLoadFactor ;
+    nextLoadFactor = currLoadFactor + 1.0 / nSteps ;  timeIndex++ ;
+    if ( timeIndex == checkpointIndex ){
+      timer.tic() ;
+      sessionCheckpoint( first, U, Udot, Udotdot, currLoadFactor, nextLoadFactor, \
+        currTime, timeIndex, path, checkpoint ) ;
+      checkpointTime = timer.toc() ;
+    }
+  }
+  sessionCheckpointWait( checkpoint ) ;
+  Ufirst = U ;
+
+  // second session: restart, with the values of the checkpoint
+  solverSession second ;
+  timer.tic() ;
+  blockSession( nx, ny, nz, nSteps, 1, path, second ) ;
+  double restartSetupTime = timer.toc() ;
+
+  U.zeros() ;  Udot.zeros() ;  Udotdot.zeros() ;
+  if ( !sessionRestoreState( second, U, Udot, Udotdot, currLoadFactor, \
+         nextLoadFactor, currTime, timeIndex ) ){
+    cout << "the checkpoint " << path << " was not read" << endl ;
+    return 1 ;
+  }
+  uint restartIndex = timeIndex ;
+  while ( timeIndex <= uint( nSteps ) ){
+    sessionTimeStep( U, Udot, Udotdot, currLoadFactor, nextLoadFactor, currTime, \
+      timeIndex, second, Ut, Utp1, Udottp1, Udotdottp1, auxOutValsVec ) ;
+    U = Utp1 ;  Udot = Udottp1 ;  Udotdot = Udotdottp1 ;
+    currTime = auxOutValsVec(0) ;  currLoadFactor = nextLoadFactor ;
+    nextLoadFactor = currLoadFactor + 1.0 / nSteps ;  timeIndex++ ;
+  }
+  remove( path.c_str() ) ;
+
+  double maxDiff = norm( U - Ufirst, "inf" ) ;
+  printf( "free dofs: %u | steps: %d | restart at time index %u\n", \
+    (uint) first.model.redDofs.n_elem, nSteps, restartIndex ) ;
+  printf( "setup:                       %10.4f s\n", setupTime ) ;
+  printf( "setup from the checkpoint:   %10.4f s\n", restartSetupTime ) ;
+  printf( "checkpoint copy (written by a thread): %10.4f s\n", checkpointTime ) ;
+  printf( "max difference of the final displacements: %.2e\n", maxDiff ) ;
+
+  if ( restartIndex != checkpointIndex || maxDiff != 0 ){
+    cout << "the restarted run is different" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
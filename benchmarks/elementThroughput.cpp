@@ -0,0 +1,148 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Throughput (elements per second) of the tetrahedron kernels computing
+// internal forces and tangent matrix, on the elements of a generated block
+// with a nonzero displacement field. Also reports the largest difference
+// of each kernel with respect to elementTetraSolid, and returns 1 when it is
+// not at round-off level (relative to the largest entry).
+//
+// usage (from src, after make bench):
+//   ./elementThroughput.lnx [nEvaluations]
+
+#include "benchMesh.h"
+
+using namespace std  ;
+using namespace arma ;
+
+int main( int argc, char * argv[] ){
+
+  int nEvals = 200000 ;
+  if ( argc >= 2 ){ nEvals = atoi( argv[1] ) ; }
+
+  imat conec ;  mat coordsElemsMat, materialsParamsMat, elementsParamsMat ;
+  uvec neumdofs ;  vec variableFext ;
+  generateTetraBlockMesh( 8, 4, 4, conec, coordsElemsMat, materialsParamsMat, \
+    elementsParamsMat, neumdofs, variableFext ) ;
+  int nElems = conec.n_rows ;
+
+  modelData model ;
+  computeModelData( conec, coordsElemsMat, elementsParamsMat, conec.cols( 0, 3 ).max(), model ) ;
+
+  mat elemFunders ;  vec elemVols ;
+  computeElemGeometry( model, elemFunders, elemVols ) ;
+
+  // displacements of the nodes of each element
+  mat elemsDisps( 12, nElems ) ;
+  for ( int elem=0; elem < nElems; elem++){
+    for ( int ind=0; ind < 12; ind++){
+      elemsDisps( ind, elem ) = 0.05 * sin( 0.7 * ind + 0.3 * elem ) ;
+    }
+  }
+  double young = materialsParamsMat( 0, 2 ), nu = materialsParamsMat( 0, 3 ) ;
+  vec consParams = { 2, young, nu } ;
+
+  wall_clock timer ;
+  double checksum = 0 ;
+
+  // reference kernel
+  vec Finte( 12 ) ;  mat KTe( 12, 12 ) ;
+  timer.tic() ;
+  for ( int k=0; k < nEvals; k++){
+    int elem = k % nElems ;
+    mat funder = reshape( elemFunders.col( elem ), 4, 3 ) ;
+    elementTetraSolid( funder, elemVols( elem ), elemsDisps.col( elem ), consParams, \
+      2, 2, 0, Finte, KTe ) ;
+    checksum += KTe( 0, 0 ) ;
+  }
+  double timeRef = timer.toc() ;
+
+  // fixed size kernel
+  vec::fixed<12> FinteFix ;  mat::fixed<12,12> KTeFix ;
+  timer.tic() ;
+  for ( int k=0; k < nEvals; k++){
+    int elem = k % nElems ;
+    elementTetraSVK( elemFunders.colptr( elem ), elemVols( elem ), \
+      elemsDisps.colptr( elem ), young, nu, 2, 2, FinteFix, KTeFix ) ;
+    checksum += KTeFix( 0, 0 ) ;
+  }
+  double timeFix = timer.toc() ;
+
+  // batched kernel, in structure of arrays form
+  const int W = tetraBatchWidth ;
+  int nBatches = nElems / W ;
+  mat fundersSoA( 12*W, nBatches ), volsSoA( W, nBatches ), dispsSoA( 12*W, nBatches ) ;
+  for ( int batch=0; batch < nBatches; batch++){
+    for ( int l=0; l < W; l++){
+      volsSoA( l, batch ) = elemVols( batch*W + l ) ;
+      for ( int ind=0; ind < 12; ind++){
+        fundersSoA( ind*W + l, batch ) = elemFunders( ind, batch*W + l ) ;
+        dispsSoA  ( ind*W + l, batch ) = elemsDisps ( ind, batch*W + l ) ;
+      }
+    }
+  }
+  vec FinteBatch( 12*W ) ;  vec KTeBatch( 144*W ) ;
+  timer.tic() ;
+  for ( int k=0; k < nEvals / W; k++){
+    int batch = k % nBatches ;
+    elementTetraSVKBatch( fundersSoA.colptr( batch ), volsSoA.colptr( batch ), \
+      dispsSoA.colptr( batch ), young, nu, 2, 2, FinteBatch.memptr(), KTeBatch.memptr() ) ;
+    checksum += KTeBatch( 0 ) ;
+  }
+  double timeBatch = timer.toc() ;
+
+  // differences on every element
+  double maxDiff = 0, maxDiffBatch = 0, maxVal = 0 ;
+  for ( int elem=0; elem < nElems; elem++){
+    mat funder = reshape( elemFunders.col( elem ), 4, 3 ) ;
+    elementTetraSolid( funder, elemVols( elem ), elemsDisps.col( elem ), consParams, \
+      2, 2, 0, Finte, KTe ) ;
+    elementTetraSVK( elemFunders.colptr( elem ), elemVols( elem ), \
+      elemsDisps.colptr( elem ), young, nu, 2, 2, FinteFix, KTeFix ) ;
+    maxDiff = max( maxDiff, max( abs( vectorise( KTe - KTeFix ) ) ) ) ;
+    maxDiff = max( maxDiff, max( abs( Finte - FinteFix ) ) ) ;
+    maxVal  = max( maxVal , max( abs( vectorise( KTe ) ) ) ) ;
+
+    int batch = elem / W, l = elem % W ;
+    if ( batch < nBatches ){
+      elementTetraSVKBatch( fundersSoA.colptr( batch ), volsSoA.colptr( batch ), \
+        dispsSoA.colptr( batch ), young, nu, 2, 2, FinteBatch.memptr(), KTeBatch.memptr() ) ;
+      for ( int ind=0; ind < 12; ind++){
+        maxDiffBatch = max( maxDiffBatch, abs( Finte( ind ) - FinteBatch( ind*W + l ) ) ) ;
+      }
+      for ( int ind=0; ind < 144; ind++){
+        maxDiffBatch = max( maxDiffBatch, abs( KTe( ind ) - KTeBatch( ind*W + l ) ) ) ;
+      }
+    }
+  }
+
+  cout << "kernel              elements/s" << endl ;
+  printf( "elementTetraSolid   %10.0f\n", nEvals / timeRef ) ;
+  printf( "elementTetraSVK     %10.0f   (x%.1f)\n", nEvals / timeFix, timeRef / timeFix ) ;
+  printf( "elementTetraSVKBatch %9.0f   (x%.1f, %d lanes, %s)\n", nBatches > 0 ? \
+    ( nEvals / W ) * W / timeBatch : 0., timeRef / timeBatch * ( nEvals / W ) * W / nEvals, \
+    W, tetraSVKBatchISA() ) ;
+  printf( "max difference: %.3e fixed, %.3e batched (max entry %.3e) | checksum %g\n", \
+    maxDiff, maxDiffBatch, maxVal, checksum ) ;
+
+  double tol = 1e-12 * maxVal ;
+  if ( maxDiff > tol || maxDiffBatch > tol ){
+    cout << "kernels differ from elementTetraSolid beyond round-off" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
@@ -0,0 +1,134 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Memory and time of the linear solvers of the reduced tangent system, on a
+// generated tetrahedra block at the iterate of the first Newton iteration:
+// the LDL' factorization (the direct path) and the conjugate gradients and
+// MINRES methods with the node blocks Jacobi and the smoothed aggregation
+// preconditioners, and conjugate gradients with the matrix-free tangent
+// operator (stored and recomputed element matrices), with relative tolerance
+// relTol. For each solver it reports the bytes of its data (factor,
+// preconditioner, work vectors and element matrices; the assembled matrix is
+// not included), the setup (factorization, preconditioner and element
+// matrices) and solve times, the iterations, the
+// relative residual and the relative difference with the LDL' solution; it
+// returns 1 when a residual is above 100 relTol (MINRES stops on the norm of
+// the preconditioned residual) or when a solver reports convergence (see
+// iterativeSolverConverged) with a residual above it.
+//
+// usage (from src, after make bench):
+//   ./linearSolverComparison.lnx [nx ny nz] [relTol]
+
+#include "benchMesh.h"
+
+using namespace std  ;
+using namespace arma ;
+
+int main( int argc, char * argv[] ){
+
+  int nx = 40, ny = 10, nz = 10 ;  double relTol = 1e-8 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ relTol = atof( argv[4] ) ; }
+
+  modelData model ;  assemblyData assembly ;
+  assembly.strategy = 1 ;
+  generateTetraBlockModel( nx, ny, nz, model, assembly ) ;
+
+  // tangent matrix at the first Newton iterate
+  solverState state ;
+  state.nextLoadFactor = 1 ;
+  state.Ut.zeros( model.dofsPerNode*model.nNodes ) ;
+  state.Udott = state.Ut ;  state.Udotdott = state.Ut ;  state.Utp1k = state.Ut ;
+  updateTime( model, state ) ;
+  computeRHSAndMatrix( model, assembly, state ) ;
+  state.linearSolver.method = 1 ;
+  linearSolverSetup( model, assembly, state.linearSolver ) ;
+  vec currDeltau( model.redDofs.n_elem, fill::zeros ) ;
+  computeDeltaU( model, assembly, 1, currDeltau, state ) ;
+  updateUiter( state.deltaured, model.redDofs, 1, state.Utp1k ) ;
+  computeRHSAndMatrix( model, assembly, state ) ;
+
+  const sp_mat & A = state.systemDeltauMatrix ;
+  const vec    & b = state.systemDeltauRHS ;
+  printf( "free dofs: %u | nnz: %u | matrix %.2f MB | relTol %.1e\n", (uint) A.n_rows, \
+    (uint) A.n_nonzero, ( 12.0 * A.n_nonzero + 8.0 * A.n_cols ) / 1e6, relTol ) ;
+  printf( "solver                 data (MB)  setup (s)  solve (s)  iterations  residual  difference  converged\n" ) ;
+
+  const uint methods[7]          = { 1, 2, 2, 3, 3, 2, 2 } ;
+  const uint preconditioners[7]  = { 0, 1, 2, 1, 2, 1, 1 } ;
+  const uint tangentOperators[7] = { 0, 0, 0, 0, 0, 1, 2 } ;
+  const char * names[7] = { "LDL'", "CG, block Jacobi", "CG, aggregation", \
+                            "MINRES, block Jacobi", "MINRES, aggregation", \
+                            "CG, stored elements", "CG, element products" } ;
+  wall_clock timer ;
+  vec xDirect, x ;
+  bool ok = true ;
+
+  for ( int s=0; s < 7; s++){
+    linearSolverData solver ;
+    solver.method = methods[s] ;  solver.preconditioner = preconditioners[s] ;
+    solver.maxIts = 5000 ;
+    linearSolverSetup( model, assembly, solver ) ;
+
+    double setupTime, solveTime, elementBytes = 0 ;
+    bool converged = true ;
+    if ( tangentOperators[s] > 0 ){
+      assemblyData mfAssembly = assembly ;
+      mfAssembly.tangentOperator = tangentOperators[s] ;
+      solverState mfState ;
+      mfState.Utp1k = state.Utp1k ;
+      timer.tic() ;
+      computeMatrixFree( model, mfAssembly, mfState ) ;
+      elementBlockJacobiSetup( model, mfAssembly, mfState.Utangent, \
+        mfState.elemTangents, solver ) ;
+      setupTime = timer.toc() ;
+      solver.factorized = true ;  solver.factorizedVersion = mfState.matrixVersion ;
+      timer.tic() ;
+      converged = matrixFreeSolve( model, mfAssembly, mfState.Utangent, \
+        mfState.elemTangents, mfState.matrixVersion, b, relTol, solver, x ) ;
+      solveTime = timer.toc() ;
+      elementBytes = 8.0 * mfState.elemTangents.n_elem ;
+    }else if ( solver.method == 1 ){
+      timer.tic() ;  linearSolverFactorize( A, solver ) ;  setupTime = timer.toc() ;
+      timer.tic() ;  linearSolverSolve( A, 0, b, solver, x ) ;  solveTime = timer.toc() ;
+      xDirect = x ;
+    }else{
+      timer.tic() ;  preconditionerSetup( A, solver ) ;  setupTime = timer.toc() ;
+      solver.factorized = true ;
+      timer.tic() ;
+      converged = iterativeSolverSolve( A, 0, b, relTol, solver, x ) ;
+      solveTime = timer.toc() ;
+    }
+    vec Ax( A.n_rows ) ;
+    sparseTransposeProduct( A, x.memptr(), Ax.memptr() ) ;
+    double residual   = norm( b - Ax ) / norm( b ) ;
+    double difference = norm( x - xDirect ) / norm( xDirect ) ;
+    if ( !( residual <= 100 * relTol ) ){ ok = false ; }
+    if ( converged && !( residual <= 100 * iterativeSolverTolFactor * relTol ) ){ ok = false ; }
+
+    printf( "%-22s %10.2f %10.4f %10.4f %11u  %8.1e  %10.2e  %9s\n", names[s], \
+      ( linearSolverBytes( solver ) + elementBytes ) / 1e6, setupTime, solveTime, \
+      solver.method == 1 ? 0 : solver.lastIters, residual, difference, \
+      converged ? "yes" : "no" ) ;
+  }
+
+  if ( !ok ){
+    cout << "the residuals are not within the tolerance" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
@@ -0,0 +1,108 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Time of the linear solves of a sequence of tangent matrices, assembled at
+// the iterates of a Newton iteration on a generated tetrahedra block: spsolve
+// for each matrix, against the LDL' solver with the ordering and symbolic
+// factorization computed once. Reports the fill of the factor and the
+// largest relative difference of the two solutions, and returns 1 when it is
+// not small.
+//
+// usage (from src, after make bench):
+//   ./linearSolverReuse.lnx [nx ny nz] [nMatrices]
+
+#include "benchMesh.h"
+
+using namespace std  ;
+using namespace arma ;
+
+int main( int argc, char * argv[] ){
+
+  int nx = 20, ny = 6, nz = 6, nMatrices = 4 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ nMatrices = atoi( argv[4] ) ; }
+
+  modelData model ;  assemblyData assembly ;
+  assembly.strategy = 1 ;
+  generateTetraBlockModel( nx, ny, nz, model, assembly ) ;
+
+  // tangent matrices and residuals at the iterates of a Newton iteration
+  solverState state ;
+  state.nextLoadFactor = 1 ;
+  state.Ut.zeros( model.dofsPerNode*model.nNodes ) ;
+  state.Udott = state.Ut ;  state.Udotdott = state.Ut ;  state.Utp1k = state.Ut ;
+  updateTime( model, state ) ;
+
+  field<sp_mat> matrices( nMatrices ) ;  field<vec> rhss( nMatrices ) ;
+  for ( int m=0; m < nMatrices; m++){
+    computeRHSAndMatrix( model, assembly, state ) ;
+    matrices( m ) = state.systemDeltauMatrix ;  rhss( m ) = state.systemDeltauRHS ;
+    vec deltaured = spsolve( matrices( m ), rhss( m ) ) ;
+    updateUiter( deltaured, model.redDofs, 1, state.Utp1k ) ;
+  }
+
+  wall_clock timer ;
+  field<vec> solutions( nMatrices ) ;
+  timer.tic() ;
+  for ( int m=0; m < nMatrices; m++){ solutions( m ) = spsolve( matrices( m ), rhss( m ) ) ; }
+  double spsolveTime = timer.toc() / nMatrices ;
+
+  linearSolverData solver ;
+  timer.tic() ;
+  linearSolverSetup( model, assembly, solver ) ;
+  double analysisTime = timer.toc() ;
+
+  double factorTime = 0, solveTime = 0, maxDiff = 0 ;
+  vec x ;
+  for ( int m=0; m < nMatrices; m++){
+    timer.tic() ;
+    bool factorized = linearSolverFactorize( matrices( m ), solver ) ;
+    factorTime += timer.toc() ;
+    if ( !factorized ){ cout << "matrix " << m << " not factorized" << endl ;  return 1 ; }
+    solver.factorizedVersion = m ;
+
+    // second solve with the same factorization
+    timer.tic() ;
+    linearSolverSolve( matrices( m ), m, rhss( m ), solver, x ) ;
+    linearSolverSolve( matrices( m ), m, rhss( m ), solver, x ) ;
+    solveTime += timer.toc() / 2 ;
+    maxDiff = max( maxDiff, norm( x - solutions( m ), "inf" ) / norm( solutions( m ), "inf" ) ) ;
+  }
+  factorTime /= nMatrices ;  solveTime /= nMatrices ;
+
+  uword nnzA = 0 ;
+  for ( uword col=0; col < assembly.colPtrs.n_elem-1; col++){
+    for ( uword p=assembly.colPtrs( col ); p < assembly.colPtrs( col+1 ); p++){
+      if ( assembly.rowInds( p ) < col ){ nnzA++ ; }
+    }
+  }
+  printf( "free dofs: %u | nnz upper(A): %u | nnz(L): %u | fill ratio %.2f\n", \
+    (uint) model.redDofs.n_elem, (uint) nnzA, (uint) solver.Lp( solver.Lp.n_elem-1 ), \
+    double( solver.Lp( solver.Lp.n_elem-1 ) ) / nnzA ) ;
+  printf( "spsolve per matrix:          %10.4f s\n", spsolveTime ) ;
+  printf( "LDL' analysis, once:         %10.4f s\n", analysisTime ) ;
+  printf( "LDL' factorization + solve:  %10.4f s\n", factorTime + solveTime ) ;
+  printf( "LDL' solve, reused factor:   %10.4f s\n", solveTime ) ;
+  printf( "negative pivots: %u | max relative difference with spsolve: %.2e\n", \
+    solver.nNegPivots, maxDiff ) ;
+
+  if ( maxDiff > 1e-8 ){
+    cout << "the LDL' and spsolve solutions are different" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
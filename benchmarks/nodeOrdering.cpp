@@ -0,0 +1,128 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Effect of the node renumbering of renumberModel on a generated tetrahedra
+// block with its nodes numbered at random, as an unstructured mesher may do.
+// For each ordering (0 the input numbering, 1 reverse Cuthill-McKee,
+// 2 minimum degree, 3 nested dissection) it reports the bandwidth, profile
+// and fill of the nodes graph, the time of the tangent assembly, and the
+// nnz of the LDL' factor and its analysis and factorization times (with the
+// minimum degree ordering of the solver for 0 and 1, and the node order for
+// 2 and 3). The first Newton increment, in the input numbering, is compared
+// with the one of ordering 0 and 1 is returned when they differ.
+//
+// usage (from src, after make bench):
+//   ./nodeOrdering.lnx [nx ny nz]
+
+#include "benchMesh.h"
+#include <random>
+
+using namespace std  ;
+using namespace arma ;
+
+int main( int argc, char * argv[] ){
+
+  int nx = 24, ny = 8, nz = 8 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+
+  imat conec ;  mat coordsElemsMat, materialsParamsMat, elementsParamsMat ;
+  uvec neumdofs ;  vec variableFext ;
+  generateTetraBlockMesh( nx, ny, nz, conec, coordsElemsMat, materialsParamsMat, \
+    elementsParamsMat, neumdofs, variableFext ) ;
+
+  // random numbering of the nodes, in the input files numbering
+  uword nNodes = (nx+1)*(ny+1)*(nz+1) ;
+  uvec shuffled = regspace<uvec>( 0, nNodes-1 ) ;
+  std::shuffle( shuffled.begin(), shuffled.end(), std::mt19937( 1 ) ) ;
+  for ( uword elem=0; elem < conec.n_rows; elem++){
+    for ( int ind=0; ind < 4; ind++){ conec( elem, ind ) = shuffled( conec( elem, ind )-1 ) + 1 ; }
+  }
+  for ( uword i=0; i < neumdofs.n_elem; i++){
+    uword node = ( neumdofs( i )-1 ) / 6 ;
+    neumdofs( i ) = 6*shuffled( node ) + ( neumdofs( i )-1 ) % 6 + 1 ;
+  }
+  neumdofs = sort( neumdofs ) ;
+  vec fext( variableFext.n_elem ) ;
+  for ( uword node=0; node < nNodes; node++){
+    fext.subvec( 6*shuffled( node ), 6*shuffled( node )+5 ) = variableFext.subvec( 6*node, 6*node+5 ) ;
+  }
+
+  printf( "nodes: %u | elements: %u\n", (uint) nNodes, (uint) conec.n_rows ) ;
+  printf( "ordering  bandwidth   profile  nnz(L) nodes  assembly (s)  nnz(L) dofs  analysis (s)  factorization (s)\n" ) ;
+
+  wall_clock timer ;
+  vec firstIncrement ;
+  bool ok = true ;
+
+  for ( uint ordering=0; ordering <= 3; ordering++){
+    modelData model ;  assemblyData assembly ;
+    model.materialsParamsMat = materialsParamsMat ;
+    model.elementsParamsMat  = elementsParamsMat ;
+    model.numericalMethodParams = { 1, 1e-8, 1e-8, 30, 1, 1 } ;
+    computeModelData( conec, coordsElemsMat, elementsParamsMat, nNodes, model ) ;
+    renumberModel( model, ordering ) ;
+    computeDofsNumbering( neumdofs, true, model ) ;
+    dofsOnsasToModel( model, fext, model.variableFext ) ;
+    model.constantFext.zeros( model.variableFext.n_elem ) ;
+
+    uword bandwidth, profile, factorNnz ;
+    nodeOrderingStats( model, bandwidth, profile, factorNnz ) ;
+
+    computeElemGeometry( model, assembly.elemFunders, assembly.elemVols ) ;
+    computeSparsityPattern( model, model.dofsMap, model.neumdofs.n_elem, \
+      assembly.colPtrs, assembly.rowInds, assembly.elemSlots ) ;
+    assembly.strategy = 0 ;
+
+    solverState state ;
+    state.nextLoadFactor = 1 ;
+    state.Ut.zeros( model.dofsPerNode*model.nNodes ) ;
+    state.Udott = state.Ut ;  state.Udotdott = state.Ut ;  state.Utp1k = state.Ut ;
+    updateTime( model, state ) ;
+    timer.tic() ;
+    computeRHSAndMatrix( model, assembly, state ) ;
+    double assemblyTime = timer.toc() ;
+
+    linearSolverData & solver = state.linearSolver ;
+    solver.naturalOrder = ordering >= 2 ;
+    timer.tic() ;
+    linearSolverSetup( model, assembly, solver ) ;
+    double analysisTime = timer.toc() ;
+    timer.tic() ;
+    linearSolverFactorize( state.systemDeltauMatrix, solver ) ;
+    double factorTime = timer.toc() ;
+    solver.factorizedVersion = state.matrixVersion ;
+    vec x ;
+    linearSolverSolve( state.systemDeltauMatrix, state.matrixVersion, state.systemDeltauRHS, solver, x ) ;
+
+    vec U( model.dofsPerNode*model.nNodes, fill::zeros ), Uonsas ;
+    for ( uword i=0; i < model.redDofs.n_elem; i++){ U( model.redDofs( i ) ) = x( i ) ; }
+    dofsModelToOnsas( model, U, Uonsas ) ;
+    if ( ordering == 0 ){ firstIncrement = Uonsas ; }
+    double difference = norm( Uonsas - firstIncrement, "inf" ) / norm( firstIncrement, "inf" ) ;
+    if ( !( difference < 1e-8 ) ){ ok = false ; }
+
+    printf( "%8u %10u %9u %13u %13.4f %12u %13.4f %18.4f\n", ordering, (uint) bandwidth, \
+      (uint) profile, (uint) factorNnz, assemblyTime, (uint) solver.Lp( solver.Lp.n_elem-1 ), \
+      analysisTime, factorTime ) ;
+  }
+
+  if ( !ok ){
+    cout << "the increments of the orderings are different" << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
@@ -0,0 +1,252 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Memory traffic profile of the Newton iteration of timeStepIteration on a
+// generated tetrahedra block: for each phase (assembly, linear solve,
+// updates and convergence test) the heap bytes allocated and the number of
+// allocations per iteration, and the time. Every copy of a matrix or vector
+// passed by value is an allocation of its size followed by a memcpy, so the
+// bytes allocated per iteration, compared with the size of the model, measure
+// the copy traffic of the data flow (the linear solver also allocates its
+// own factors). The allocations are counted by interposing the glibc
+// allocation functions, used both by operator new and by Armadillo. The
+// tangent matrix has half storage (see computeHalfPattern) unless
+// symmetricStorage is 0, and its size with full storage is also reported.
+// With byValue set to 1, each phase also makes the copies of the arguments
+// passed by value by the solver chain before the data was passed by
+// reference: the functions of the baseline (assembler, computeRHS,
+// computeMatrix, computeDeltaU, updateUiter, updateTime, convergenceTest)
+// are replayed with their signatures and the inputs they received (6 dofs
+// per node, connectivity and coordinates of the elements), and empty
+// bodies, so the difference of the two modes is the copy traffic removed.
+//
+// usage (from src, after make bench):
+//   ./solverMemoryProfile.lnx [nx ny nz] [nIters] [symmetricStorage] [byValue]
+
+#include "benchMesh.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+using namespace std  ;
+using namespace arma ;
+
+// heap allocation counters
+static atomic<size_t> allocBytes( 0 ), allocCount( 0 ) ;
+
+extern "C" {
+  void * __libc_malloc( size_t size ) ;
+  void * __libc_calloc( size_t n, size_t size ) ;
+  void * __libc_memalign( size_t alignment, size_t size ) ;
+
+  void * malloc( size_t size ){
+    allocBytes += size ;  allocCount ++ ;
+    return __libc_malloc( size ) ;
+  }
+  void * calloc( size_t n, size_t size ){
+    allocBytes += n*size ;  allocCount ++ ;
+    return __libc_calloc( n, size ) ;
+  }
+  int posix_memalign( void ** p, size_t alignment, size_t size ){
+    allocBytes += size ;  allocCount ++ ;
+    *p = __libc_memalign( alignment, size ) ;
+    return ( *p == nullptr ) ? ENOMEM : 0 ;
+  }
+}
+
+// signatures of the by value data flow of the baseline, see byValue
+static volatile uword byValueSink = 0 ;
+
+__attribute__((noinline)) static void byValueExtractMethodParams( vec numericalMethodParams ){
+  byValueSink += numericalMethodParams.n_elem ;
+}
+
+__attribute__((noinline)) static void byValueAssembler( imat conec, mat crossSecsParamsMat, \
+  mat coordsElemsMat, mat materialsParamsMat, sp_mat KS, vec Ut, int paramOut, vec Udott, \
+  vec Udotdott, double nodalDispDamping, uint solutionMethod, uvec neumdofs, \
+  mat elementsParamsMat ){
+  byValueSink += conec.n_elem + coordsElemsMat.n_elem + Ut.n_elem + neumdofs.n_elem ;
+}
+
+__attribute__((noinline)) static void byValueComputeFext( vec constantFext, \
+  vec variableFext, double nextLoadFactor, string userLoadsFilename ){
+  byValueSink += constantFext.n_elem + variableFext.n_elem ;
+}
+
+__attribute__((noinline)) static void byValueComputeRHS( imat conec, mat crossSecsParamsMat, \
+  mat coordsElemsMat, mat materialsParamsMat, sp_mat KS, vec constantFext, vec variableFext, \
+  string userLoadsFilename, double currLoadFactor, double nextLoadFactor, \
+  vec numericalMethodParams, uvec neumdofs, double nodalDispDamping, vec Ut, vec Udott, \
+  vec Udotdott, vec Utp1, vec Udottp1, vec Udotdottp1, mat elementsParamsMat ){
+  byValueExtractMethodParams( numericalMethodParams ) ;
+  byValueAssembler( conec, crossSecsParamsMat, coordsElemsMat, materialsParamsMat, KS, \
+    Utp1, 1, Udottp1, Udotdottp1, nodalDispDamping, 1, neumdofs, elementsParamsMat ) ;
+  byValueComputeFext( constantFext, variableFext, nextLoadFactor, userLoadsFilename ) ;
+}
+
+__attribute__((noinline)) static void byValueComputeMatrix( imat conec, mat crossSecsParamsMat, \
+  mat coordsElemsMat, mat materialsParamsMat, sp_mat KS, vec Uk, uvec neumdofs, \
+  vec numericalMethodParams, double nodalDispDamping, vec Udott, vec Udotdott, \
+  mat elementsParamsMat ){
+  byValueExtractMethodParams( numericalMethodParams ) ;
+  byValueAssembler( conec, crossSecsParamsMat, coordsElemsMat, materialsParamsMat, KS, \
+    Uk, 2, Udott, Udotdott, nodalDispDamping, 1, neumdofs, elementsParamsMat ) ;
+}
+
+__attribute__((noinline)) static void byValueComputeDeltaU( sp_mat systemDeltauMatrix, \
+  vec systemDeltauRHS, uint dispIter, vec numericalMethodParams, double nextLoadFactor, \
+  vec currDeltau ){
+  byValueSink += systemDeltauMatrix.n_nonzero + systemDeltauRHS.n_elem ;
+}
+
+__attribute__((noinline)) static vec byValueUpdateUiter( vec Utp1k, vec deltaured, \
+  uvec neumdofs, uint solutionMethod ){
+  return Utp1k ;
+}
+
+__attribute__((noinline)) static void byValueUpdateTime( vec Ut, vec Udott, vec Udotdott, \
+  vec Utp1k, vec numericalMethodParams, double currTime ){
+  byValueExtractMethodParams( numericalMethodParams ) ;
+}
+
+__attribute__((noinline)) static void byValueConvergenceTest( vec numericalMethodParams, \
+  vec redFext, vec redDeltaU, vec redUk, uint dispIters, vec systemDeltauRHS ){
+  byValueExtractMethodParams( numericalMethodParams ) ;
+}
+
+struct phaseCounter {
+  size_t bytes = 0, count = 0 ;  double time = 0 ;
+  size_t bytes0, count0 ;  wall_clock timer ;
+  void start(){ bytes0 = allocBytes ;  count0 = allocCount ;  timer.tic() ; }
+  void stop (){ time += timer.toc() ;  bytes += allocBytes - bytes0 ;  count += allocCount - count0 ; }
+} ;
+
+int main( int argc, char * argv[] ){
+
+  int nx = 20, ny = 6, nz = 6, nIters = 3, symmetricStorage = 1, byValue = 0 ;
+  if ( argc >= 4 ){ nx = atoi( argv[1] ) ; ny = atoi( argv[2] ) ; nz = atoi( argv[3] ) ; }
+  if ( argc >= 5 ){ nIters = atoi( argv[4] ) ; }
+  if ( argc >= 6 ){ symmetricStorage = atoi( argv[5] ) ; }
+  if ( argc >= 7 ){ byValue = atoi( argv[6] ) ; }
+
+  modelData model ;  assemblyData assembly ;
+  assembly.strategy = 1 ;
+  generateTetraBlockModel( nx, ny, nz, model, assembly ) ;
+
+  solverState state ;
+  state.nextLoadFactor = 1 ;
+  state.Ut.zeros( model.dofsPerNode*model.nNodes ) ;
+  state.Udott    = state.Ut ;
+  state.Udotdott = state.Ut ;
+  state.Utp1k    = state.Ut ;
+  updateTime( model, state ) ;
+  computeRHSAndMatrix( model, assembly, state ) ;
+  linearSolverSetup( model, assembly, state.linearSolver ) ;
+
+  double fullMatrixBytes = 8.0 * ( 2 * assembly.rowInds.n_elem + assembly.colPtrs.n_elem ) ;
+  if ( symmetricStorage ){
+    linearSolverData & solver = state.linearSolver ;
+    computeHalfPattern( solver.permInv, assembly.colPtrs, assembly.rowInds, assembly.elemSlots ) ;
+    solver.colPtrs = assembly.colPtrs ;  solver.rowInds = assembly.rowInds ;
+    fullToHalfStorage( solver.permInv, state.systemDeltauMatrix ) ;
+    solver.halfStored = true ;
+  }
+
+  // bytes of the model and assembly data, and of the state vectors
+  double modelBytes = 8.0 * ( model.nodeCoordsX.n_elem * 3 + model.elemNodes.n_elem / 2 \
+    + assembly.elemFunders.n_elem + assembly.elemVols.n_elem + assembly.colPtrs.n_elem \
+    + assembly.rowInds.n_elem ) + 4.0 * assembly.elemSlots.n_elem ;
+  double stateBytes = 8.0 * ( 6 * state.Ut.n_elem + state.FextG.n_elem ) ;
+  double matrixBytes = 8.0 * ( 2 * assembly.rowInds.n_elem + assembly.colPtrs.n_elem ) ;
+
+  // inputs of the by value data flow, in the ONSAS numbering and with the
+  // full tangent matrix
+  imat conec ;  mat coordsElemsMat, materialsParamsMat, elementsParamsMat, crossSecsParamsMat ;
+  uvec neumdofs ;  vec variableFext ;
+  generateTetraBlockMesh( nx, ny, nz, conec, coordsElemsMat, materialsParamsMat, \
+    elementsParamsMat, neumdofs, variableFext ) ;
+  uword nDofs = 6 * model.nNodes ;
+  sp_mat KS( nDofs, nDofs ), fullMatrix ;
+  vec constantFext( nDofs, fill::zeros ), onsasU( nDofs, fill::zeros ), onsasFext ;
+  vec numericalMethodParams = model.numericalMethodParams ;
+
+  vec currDeltau( model.neumdofs.n_elem, fill::zeros ) ;
+  bool booleanConverged ;  uint stopCritPar ;  double deltaErrLoad ;
+  phaseCounter assemblyPhase, solvePhase, updatesPhase ;
+
+  for ( int iter=1; iter <= nIters; iter++){
+    if ( byValue ){
+      if ( state.linearSolver.halfStored ){
+        halfToFullStorage( state.systemDeltauMatrix, fullMatrix ) ;
+      }else{
+        fullMatrix = state.systemDeltauMatrix ;
+      }
+    }
+
+    solvePhase.start() ;
+    computeDeltaU( model, assembly, iter, currDeltau, state ) ;
+    if ( byValue ){
+      byValueComputeDeltaU( fullMatrix, state.systemDeltauRHS, iter, numericalMethodParams, \
+        1, currDeltau ) ;
+    }
+    solvePhase.stop() ;
+
+    updatesPhase.start() ;
+    updateUiter( state.deltaured, model.redDofs, 1, state.Utp1k ) ;
+    updateTime( model, state ) ;
+    if ( byValue ){
+      onsasU = byValueUpdateUiter( onsasU, state.deltaured, neumdofs, 1 ) ;
+      byValueUpdateTime( onsasU, onsasU, onsasU, onsasU, numericalMethodParams, 0 ) ;
+    }
+    updatesPhase.stop() ;
+
+    assemblyPhase.start() ;
+    computeRHSAndMatrix( model, assembly, state ) ;
+    if ( byValue ){
+      byValueComputeMatrix( conec, crossSecsParamsMat, coordsElemsMat, materialsParamsMat, \
+        KS, onsasU, neumdofs, numericalMethodParams, 0, onsasU, onsasU, elementsParamsMat ) ;
+      byValueComputeRHS( conec, crossSecsParamsMat, coordsElemsMat, materialsParamsMat, KS, \
+        constantFext, variableFext, "", 0, 1, numericalMethodParams, neumdofs, 0, onsasU, \
+        onsasU, onsasU, onsasU, onsasU, onsasU, elementsParamsMat ) ;
+    }
+    assemblyPhase.stop() ;
+
+    updatesPhase.start() ;
+    convergenceTest( model, state, iter, booleanConverged, stopCritPar, deltaErrLoad ) ;
+    if ( byValue ){
+      onsasFext = variableFext ;
+      byValueConvergenceTest( numericalMethodParams, onsasFext.elem( neumdofs-1 ), \
+        state.deltaured, onsasU.elem( neumdofs-1 ), iter, state.systemDeltauRHS ) ;
+    }
+    updatesPhase.stop() ;
+  }
+
+  printf( "elements: %u | free dofs: %u | nnz: %u | data flow: %s\n", model.nElems, \
+    (uint) model.neumdofs.n_elem, (uint) assembly.rowInds.n_elem, \
+    byValue ? "by value (baseline)" : "by reference" ) ;
+  printf( "model+assembly data %.2f MB | state vectors %.2f MB | tangent matrix %.2f MB" \
+    " (%.2f MB with full storage)\n", modelBytes / 1e6, stateBytes / 1e6, \
+    matrixBytes / 1e6, fullMatrixBytes / 1e6 ) ;
+  printf( "phase       MB allocated/iter  allocations/iter  time/iter (s)\n" ) ;
+  const char * names[3] = { "assembly", "solve", "updates" } ;
+  phaseCounter * phases[3] = { &assemblyPhase, &solvePhase, &updatesPhase } ;
+  for ( int k=0; k<3; k++){
+    printf( "%-10s %18.2f %17.1f %14.4f\n", names[k], phases[k]->bytes / 1e6 / nIters, \
+      double( phases[k]->count ) / nIters, phases[k]->time / nIters ) ;
+  }
+  return 0 ;
+}
@@ -0,0 +1,154 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// Octave/MATLAB MEX wrapper of the libonsaspp C interface (onsasppApi.h), so
+// that ONSAS keeps one solver session for all the time steps. Built from src
+// with make mex. Usage, with the variables of the ONSAS files:
+//
+//   h = onsasppMex( 'create', Conec, coordsElemsMat, materialsParamsMat, ...
+//         elementsParamsMat, numericalMethodParams, neumdofs, constantFext, ...
+//         variableFext, nodalDispDamping, cppSolverParams, outputDir, problemName )
+//   onsasppMex( 'setTangent', h, systemDeltauMatrix )
+//   [ Ut, Utp1, Udottp1, Udotdottp1, auxOutValsVec ] = onsasppMex( 'timeStep', ...
+//         h, U, Udot, Udotdot, currLoadFactor, nextLoadFactor, currTime, timeIndex )
+//   KTred = onsasppMex( 'tangent', h )
+//   onsasppMex( 'destroy', h )
+//
+// The handle h is a uint64 scalar. cppSolverParams, outputDir and
+// problemName may be empty.
+
+#include "mex.h"
+#include "onsasppApi.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static onsasppMatrix denseArg( const mxArray * a ){
+  onsasppMatrix m ;
+  if ( !mxIsDouble( a ) || mxIsSparse( a ) ){ mexErrMsgTxt( "onsasppMex: dense double matrix expected" ) ; }
+  m.values = mxGetPr( a ) ;
+  m.nRows  = mxGetM( a ) ;
+  m.nCols  = mxGetN( a ) ;
+  return m ;
+}
+
+static std::string stringArg( const mxArray * a ){
+  if ( !mxIsChar( a ) || mxGetNumberOfElements( a ) == 0 ){ return std::string() ; }
+  char * chars = mxArrayToString( a ) ;
+  std::string s( chars ) ;
+  mxFree( chars ) ;
+  return s ;
+}
+
+static onsasppSession * handleArg( const mxArray * a ){
+  if ( !mxIsUint64( a ) || mxGetNumberOfElements( a ) != 1 ){
+    mexErrMsgTxt( "onsasppMex: session handle expected" ) ;
+  }
+  uint64_t handle ;
+  std::memcpy( &handle, mxGetData( a ), sizeof( handle ) ) ;
+  return reinterpret_cast<onsasppSession *>( handle ) ;
+}
+
+static void checkStatus( int status ){
+  if ( status != 0 ){ mexErrMsgIdAndTxt( "onsasppMex:error", "onsasppMex: %s", onsasppLastError() ) ; }
+}
+
+void mexFunction( int nlhs, mxArray * plhs[], int nrhs, const mxArray * prhs[] ){
+
+  if ( nrhs < 1 ){ mexErrMsgTxt( "onsasppMex: command expected" ) ; }
+  std::string command = stringArg( prhs[0] ) ;
+
+  if ( command == "create" ){
+    if ( nrhs != 13 ){ mexErrMsgTxt( "onsasppMex: create needs 12 arguments" ) ; }
+    std::string outputDir = stringArg( prhs[11] ), problemName = stringArg( prhs[12] ) ;
+    onsasppModelInputs inputs ;
+    inputs.conec                 = denseArg( prhs[1] ) ;
+    inputs.coordsElemsMat        = denseArg( prhs[2] ) ;
+    inputs.materialsParamsMat    = denseArg( prhs[3] ) ;
+    inputs.elementsParamsMat     = denseArg( prhs[4] ) ;
+    inputs.numericalMethodParams = denseArg( prhs[5] ) ;
+    inputs.neumdofs              = denseArg( prhs[6] ) ;
+    inputs.constantFext          = denseArg( prhs[7] ) ;
+    inputs.variableFext          = denseArg( prhs[8] ) ;
+    inputs.nodalDispDamping      = mxGetScalar( prhs[9] ) ;
+    inputs.cppSolverParams       = denseArg( prhs[10] ) ;
+    inputs.outputDir             = outputDir.c_str() ;
+    inputs.problemName           = problemName.c_str() ;
+
+    onsasppSession * session = onsasppCreate( &inputs ) ;
+    if ( session == nullptr ){ checkStatus( -1 ) ; }
+    plhs[0] = mxCreateNumericMatrix( 1, 1, mxUINT64_CLASS, mxREAL ) ;
+    uint64_t handle = reinterpret_cast<uint64_t>( session ) ;
+    std::memcpy( mxGetData( plhs[0] ), &handle, sizeof( handle ) ) ;
+
+  }else if ( command == "setTangent" ){
+    if ( nrhs != 3 || !mxIsSparse( prhs[2] ) || !mxIsDouble( prhs[2] ) || mxIsComplex( prhs[2] ) ){ mexErrMsgTxt( "onsasppMex: setTangent needs a handle and a sparse matrix" ) ; }
+    size_t n = mxGetN( prhs[2] ) ;
+    const mwIndex * jc = mxGetJc( prhs[2] ), * ir = mxGetIr( prhs[2] ) ;
+    std::vector<size_t> colPtrs( jc, jc + n+1 ), rowInds( ir, ir + jc[n] ) ;
+    checkStatus( onsasppSetTangent( handleArg( prhs[1] ), n, colPtrs.data(), \
+      rowInds.data(), mxGetPr( prhs[2] ) ) ) ;
+
+  }else if ( command == "timeStep" ){
+    if ( nrhs != 9 ){ mexErrMsgTxt( "onsasppMex: timeStep needs 8 arguments" ) ; }
+    onsasppSession * session = handleArg( prhs[1] ) ;
+    size_t nDofs = onsasppNumDofs( session ) ;
+    // U is required, Udot and Udotdot may be empty (zero)
+    for ( int k=2; k <= 4; k++){
+      if ( k > 2 && mxIsEmpty( prhs[k] ) ){ continue ; }
+      if ( !mxIsDouble( prhs[k] ) || mxIsComplex( prhs[k] ) || mxIsSparse( prhs[k] ) ){
+        mexErrMsgTxt( "onsasppMex: U, Udot and Udotdot must be real full double vectors" ) ;
+      }
+      if ( mxGetNumberOfElements( prhs[k] ) != nDofs ){ mexErrMsgTxt( "onsasppMex: wrong size of U, Udot or Udotdot" ) ; }
+    }
+    const double * Udot    = mxIsEmpty( prhs[3] ) ? nullptr : mxGetPr( prhs[3] ) ;
+    const double * Udotdot = mxIsEmpty( prhs[4] ) ? nullptr : mxGetPr( prhs[4] ) ;
+    mxArray * outs[5] ;
+    for ( int k=0; k < 4; k++){ outs[k] = mxCreateDoubleMatrix( nDofs, 1, mxREAL ) ; }
+    outs[4] = mxCreateDoubleMatrix( 4, 1, mxREAL ) ;
+    int status = onsasppTimeStep( session, mxGetPr( prhs[2] ), Udot, Udotdot, \
+      mxGetScalar( prhs[5] ), mxGetScalar( prhs[6] ), mxGetScalar( prhs[7] ), \
+      (unsigned int) mxGetScalar( prhs[8] ), mxGetPr( outs[0] ), mxGetPr( outs[1] ), \
+      mxGetPr( outs[2] ), mxGetPr( outs[3] ), mxGetPr( outs[4] ) ) ;
+    // plhs has room for the requested outputs only
+    for ( int k=0; k < 5; k++){
+      if ( k < nlhs || k == 0 ){ plhs[k] = outs[k] ; }else{ mxDestroyArray( outs[k] ) ; }
+    }
+    checkStatus( status ) ;
+
+  }else if ( command == "tangent" ){
+    if ( nrhs != 2 ){ mexErrMsgTxt( "onsasppMex: tangent needs a handle" ) ; }
+    onsasppSession * session = handleArg( prhs[1] ) ;
+    size_t n = onsasppNumFreeDofs( session ), nnz = onsasppTangentNnz( session ) ;
+    std::vector<size_t> colPtrs( n+1 ), rowInds( nnz ) ;
+    std::vector<double> values( nnz ) ;
+    checkStatus( onsasppTangent( session, colPtrs.data(), rowInds.data(), values.data() ) ) ;
+    plhs[0] = mxCreateSparse( n, n, nnz, mxREAL ) ;
+    mwIndex * jc = mxGetJc( plhs[0] ), * ir = mxGetIr( plhs[0] ) ;
+    for ( size_t i=0; i <= n; i++){ jc[ i ] = colPtrs[ i ] ; }
+    for ( size_t p=0; p < nnz; p++){ ir[ p ] = rowInds[ p ] ;  mxGetPr( plhs[0] )[ p ] = values[ p ] ; }
+
+  }else if ( command == "destroy" ){
+    if ( nrhs != 2 ){ mexErrMsgTxt( "onsasppMex: destroy needs a handle" ) ; }
+    onsasppDestroy( handleArg( prhs[1] ) ) ;
+
+  }else{
+    mexErrMsgTxt( "onsasppMex: unknown command" ) ;
+  }
+}
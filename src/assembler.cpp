@@ -0,0 +1,748 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+#include <stdexcept>
+
+using namespace std  ;
+using namespace arma ;
+
+
+// =============================================================================
+// nodes2dofs
+// =============================================================================
+ivec nodes2dofs( const ivec & nodes, int degreesPerNode ){
+
+  int  n    = nodes.n_elem ;
+  ivec dofs = zeros<ivec>( degreesPerNode * n ) ;
+  
+  for ( int i=0; i<n ; i++){
+    for ( int j=0; j< degreesPerNode; j++){
+      dofs( i * degreesPerNode + j ) = degreesPerNode*( nodes(i) - 1 ) + ( j+1 ) ;
+    }
+  }  
+  return dofs;
+}
+
+
+
+
+
+
+// =============================================================================
+// computeDofsMap
+// =============================================================================
+// builds, once per run, the dense table from global dofs to reduced (free)
+// dofs. dofsMap( gdof-1 ) is the 1-based position of gdof in neumdofs, or 0
+// if gdof is a Dirichlet dof. redDofs holds the 0-based global index of each
+// reduced dof, used to reduce and scatter full vectors.
+void computeDofsMap( const uvec & neumdofs, uint nDofs, uvec & dofsMap, uvec & redDofs ){
+
+  dofsMap = zeros<uvec>( nDofs ) ;
+  redDofs = neumdofs - 1 ;
+
+  for ( uint i=1; i<= neumdofs.n_elem; i++){
+    dofsMap( neumdofs(i-1)-1 ) = i ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// computeSparsityPattern
+// =============================================================================
+// symbolic phase of the tangent matrix assembly, computed once per run. Builds
+// the CSC pattern (colPtrs, rowInds) of the reduced tangent matrix and the
+// slot of each element stiffness entry in its values array:
+// elemSlots( (indj-1)*12 + indi-1, elem-1 ) is the 1-based position of
+// KTe(indi,indj) in the values array, or 0 if its row or column is a
+// Dirichlet dof. The slots have 32 bits, half the memory of the 144 entries
+// of each element, so the pattern may have up to 2^32-1 entries.
+void computeSparsityPattern( const modelData & model, const uvec & dofsMap, \
+  uint nRedDofs, uvec & colPtrs, uvec & rowInds, Mat<u32> & elemSlots ){
+
+  int nElems = model.nElems ;
+
+  // reduced dofs (1-based, 0 for Dirichlet) of each element
+  umat elemRedDofs( 12, nElems, fill::zeros ) ;
+  uvec dofElemsPtrs( nRedDofs+1, fill::zeros ) ;
+
+  uword dofselem[ 4*6/2 ] ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    if ( model.groupType( group ) != 4 ){ continue ; }
+    for ( uword k=model.groupPtrs( group ); k < model.groupPtrs( group+1 ); k++){
+      uword elem = model.groupElems( k ) ;
+      tetraDofs( model, elem, dofselem ) ;
+      for ( int ind=1; ind <= (4*3); ind++ ){
+        uword redDof = dofsMap( dofselem[ ind-1 ]-1 ) ;
+        elemRedDofs( ind-1, elem ) = redDof ;
+        if ( redDof > 0 ){ dofElemsPtrs( redDof ) ++ ; }
+      }
+    }
+  }
+
+  // elements connected to each reduced dof
+  for ( uint i=1; i<= nRedDofs; i++){
+    dofElemsPtrs( i ) += dofElemsPtrs( i-1 ) ;
+  }
+  uvec dofElems( dofElemsPtrs( nRedDofs ) ) ;
+  uvec nextPos = dofElemsPtrs ;
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( int ind=1; ind <= 12; ind++){
+      uword redDof = elemRedDofs( ind-1, elem-1 ) ;
+      if ( redDof > 0 ){ dofElems( nextPos( redDof-1 )++ ) = elem-1 ; }
+    }
+  }
+
+  // rows of each column: first pass counts, second pass fills. marker(row)
+  // stores the last column (1-based) where row was found.
+  uvec marker( nRedDofs, fill::zeros ) ;
+  colPtrs.zeros( nRedDofs+1 ) ;
+  for ( int pass=1; pass<=2; pass++){
+    marker.zeros() ;
+    for ( uint col=1; col <= nRedDofs; col++){
+      uword nnzCol = 0 ;
+      for ( uword k=dofElemsPtrs( col-1 ); k < dofElemsPtrs( col ); k++){
+        for ( int ind=1; ind <= 12; ind++){
+          uword row = elemRedDofs( ind-1, dofElems( k ) ) ;
+          if ( ( row > 0 ) && ( marker( row-1 ) != col ) ){
+            marker( row-1 ) = col ;
+            if ( pass == 2 ){ rowInds( colPtrs( col-1 ) + nnzCol ) = row-1 ; }
+            nnzCol++ ;
+          }
+        }
+      }
+      if ( pass == 1 ){
+        colPtrs( col ) = colPtrs( col-1 ) + nnzCol ;
+      }else{
+        std::sort( rowInds.begin() + colPtrs( col-1 ), rowInds.begin() + colPtrs( col ) ) ;
+      }
+    }
+    if ( pass == 1 ){ rowInds.zeros( colPtrs( nRedDofs ) ) ; }
+  }
+  if ( colPtrs( nRedDofs ) > 0xffffffffu ){
+    throw runtime_error( "computeSparsityPattern: too many entries for the 32 bit element slots" ) ;
+  }
+
+  // slots of the element entries in the values array
+  elemSlots.zeros( 12*12, nElems ) ;
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( int indj=1; indj<=12; indj++){
+      uword col = elemRedDofs( indj-1, elem-1 ) ;
+      if ( col == 0 ){ continue ; }
+      const uword * colBegin = rowInds.memptr() + colPtrs( col-1 ) ;
+      const uword * colEnd   = rowInds.memptr() + colPtrs( col   ) ;
+      for ( int indi=1; indi<=12; indi++){
+        uword row = elemRedDofs( indi-1, elem-1 ) ;
+        if ( row > 0 ){
+          elemSlots( (indj-1)*12 + indi-1, elem-1 ) = \
+            u32( std::lower_bound( colBegin, colEnd, row-1 ) - rowInds.memptr() ) + 1 ;
+        }
+      }
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// computeHalfPattern
+// =============================================================================
+// restricts, in place, the pattern of computeSparsityPattern to one entry of
+// each symmetric pair: ( row, col ) with permInv(row) <= permInv(col), the
+// upper triangle of the matrix ordered by the LDL' permutation (the entries
+// read by linearSolverFactorize). The slots of the dropped element entries
+// are set to 0, so that the assembler skips them.
+void computeHalfPattern( const uvec & permInv, uvec & colPtrs, uvec & rowInds, \
+  Mat<u32> & elemSlots ){
+
+  uword nCols = colPtrs.n_elem - 1 ;
+  uvec newSlots( rowInds.n_elem, fill::zeros ) ; // 1-based, 0 if dropped
+  uword nnz = 0 ;
+  for ( uword col=0; col < nCols; col++){
+    uword first = colPtrs( col ) ;
+    colPtrs( col ) = nnz ;
+    for ( uword p=first; p < colPtrs( col+1 ); p++){
+      if ( permInv( rowInds( p ) ) <= permInv( col ) ){
+        rowInds( nnz ) = rowInds( p ) ;
+        newSlots( p ) = ++nnz ;
+      }
+    }
+  }
+  colPtrs( nCols ) = nnz ;
+  rowInds.resize( nnz ) ;
+
+  for ( uword k=0; k < elemSlots.n_elem; k++){
+    if ( elemSlots( k ) > 0 ){ elemSlots( k ) = u32( newSlots( elemSlots( k )-1 ) ) ; }
+  }
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+//
+// =====================================================================
+ivec elementTypeInfo( int elemType ){
+  ivec out(2);  //~ return numNodes, dofsStep
+  if ( elemType == 1){
+    out={1,1};
+  }else if ( elemType == 4){ // tetrahedron
+    out={4,2};
+  }
+  return out ;
+}
+// =============================================================================
+
+
+
+
+
+
+// =============================================================================
+// computeElemColors
+// =============================================================================
+// greedy coloring of the elements such that no two elements of the same color
+// share a node. The elements of a color write disjoint entries of Fint and of
+// the tangent values, so each color is assembled in parallel without locks.
+// Colors are split by element group (see computeModelData), so that each one
+// is homogeneous: the elements of color c, all of group colorGroups(c), are
+// colorElems( colorPtrs(c) ... colorPtrs(c+1)-1 ), 0-based and in increasing
+// order.
+void computeElemColors( const modelData & model, uvec & colorPtrs, \
+  uvec & colorElems, uvec & colorGroups ){
+
+  int  nElems = model.nElems ;
+  uint nNodes = model.nNodes ;
+
+  // nodes per element
+  uvec elemNumNodes( nElems, fill::zeros ) ;
+  for ( int elem=1; elem <= nElems; elem++){
+    while ( elemNumNodes( elem-1 ) < 4 && \
+            model.elemNodes( (elem-1)*4 + elemNumNodes( elem-1 ) ) >= 0 ){
+      elemNumNodes( elem-1 ) ++ ;
+    }
+  }
+
+  // elements connected to each node
+  uvec nodeElemsPtrs( nNodes+1, fill::zeros ) ;
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( uword ind=1; ind <= elemNumNodes( elem-1 ); ind++){
+      nodeElemsPtrs( model.elemNodes( (elem-1)*4 + ind-1 )+1 ) ++ ;
+    }
+  }
+  for ( uint i=1; i<= nNodes; i++){
+    nodeElemsPtrs( i ) += nodeElemsPtrs( i-1 ) ;
+  }
+  uvec nodeElems( nodeElemsPtrs( nNodes ) ) ;
+  uvec nextPos = nodeElemsPtrs ;
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( uword ind=1; ind <= elemNumNodes( elem-1 ); ind++){
+      nodeElems( nextPos( model.elemNodes( (elem-1)*4 + ind-1 ) )++ ) = elem-1 ;
+    }
+  }
+
+  // greedy: each element takes the lowest color not used by its neighbours.
+  // forbidden( c ) == elem marks color c as taken for the current element.
+  uvec elemColor( nElems, fill::zeros ) ; // 1-based, 0 for not colored yet
+  uvec forbidden( nodeElems.n_elem + 2, fill::zeros ) ;
+  uword nColors = 0 ;
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( uword ind=1; ind <= elemNumNodes( elem-1 ); ind++){
+      uword node = model.elemNodes( (elem-1)*4 + ind-1 )+1 ;
+      for ( uword k=nodeElemsPtrs( node-1 ); k < nodeElemsPtrs( node ); k++){
+        forbidden( elemColor( nodeElems( k ) ) ) = elem ;
+      }
+    }
+    uword color = 1 ;
+    while ( forbidden( color ) == (uword) elem ){ color++ ; }
+    elemColor( elem-1 ) = color ;
+    nColors = max( nColors, color ) ;
+  }
+
+  // elements grouped by group and color: color c of group g is bucket
+  // g*nColors + c-1. Empty buckets are dropped.
+  uword nGroups  = model.groupPtrs.n_elem - 1 ;
+  uvec  elemGroup( nElems ) ;
+  for ( uword group=0; group < nGroups; group++){
+    for ( uword k=model.groupPtrs( group ); k < model.groupPtrs( group+1 ); k++){
+      elemGroup( model.groupElems( k ) ) = group ;
+    }
+  }
+  uvec bucketPtrs( nGroups*nColors + 1, fill::zeros ) ;
+  for ( int elem=1; elem <= nElems; elem++){
+    bucketPtrs( elemGroup( elem-1 )*nColors + elemColor( elem-1 ) ) ++ ;
+  }
+  uword nBuckets = 0 ;
+  for ( uword b=1; b < bucketPtrs.n_elem; b++){
+    nBuckets += ( bucketPtrs( b ) > 0 ) ;
+    bucketPtrs( b ) += bucketPtrs( b-1 ) ;
+  }
+  colorElems.zeros( nElems ) ;
+  nextPos = bucketPtrs ;
+  for ( int elem=1; elem <= nElems; elem++){
+    colorElems( nextPos( elemGroup( elem-1 )*nColors + elemColor( elem-1 )-1 )++ ) = elem-1 ;
+  }
+
+  colorPtrs.zeros( nBuckets+1 ) ;
+  colorGroups.zeros( nBuckets ) ;
+  uword color = 0 ;
+  for ( uword b=1; b < bucketPtrs.n_elem; b++){
+    if ( bucketPtrs( b ) > bucketPtrs( b-1 ) ){
+      colorGroups( color ) = ( b-1 ) / nColors ;
+      colorPtrs( color+1 ) = bucketPtrs( b ) ;
+      color++ ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// computePartRanges
+// =============================================================================
+// ranges written by each element part of the partial buffers strategy (see
+// assembler), so that the buffer of a part only covers them. Column part of
+// partRanges holds the first and end (0-based, end excluded) global dofs of
+// the forces and the first and end slots of the tangent values written by
+// the elements of the part. With the nodes numbered by bandwidth or fill
+// reducing orderings (see renumberModel) the parts write narrow ranges. It
+// is computed again when nParts or the pattern change.
+void computePartRanges( const modelData & model, assemblyData & assembly ){
+
+  uword nElems = model.nElems, nParts = assembly.nParts ;
+  bool slots = assembly.elemSlots.n_cols == nElems ;
+  umat & partRanges = assembly.partRanges ;
+  partRanges.zeros( 4, nParts ) ;
+
+  uword dofselem[ 4*6/2 ] ;
+  for ( uword part=0; part < nParts; part++){
+    uword partStart = ( nElems *  part    ) / nParts ;
+    uword partEnd   = ( nElems * (part+1) ) / nParts ;
+    uword firstDof = model.dofsPerNode*model.nNodes, endDof = 0 ;
+    uword firstSlot = assembly.rowInds.n_elem, endSlot = 0 ;
+    for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+      if ( model.groupType( group ) != 4 ){ continue ; }
+      uword first = max( partStart, model.groupPtrs( group   ) ) ;
+      uword last  = min( partEnd  , model.groupPtrs( group+1 ) ) ;
+      for ( uword k=first; k < last; k++){
+        uword elem = model.groupElems( k ) ;
+        tetraDofs( model, elem, dofselem ) ;
+        for ( int ind=0; ind < 12; ind++){
+          firstDof = min( firstDof, dofselem[ ind ]-1 ) ;
+          endDof   = max( endDof  , dofselem[ ind ]   ) ;
+        }
+        for ( uword ind=0; slots && ind < 144; ind++){
+          uword slot = assembly.elemSlots( ind, elem ) ;
+          if ( slot > 0 ){
+            firstSlot = min( firstSlot, slot-1 ) ;
+            endSlot   = max( endSlot  , slot   ) ;
+          }
+        }
+      }
+    }
+    if ( endDof  > firstDof  ){ partRanges( 0, part ) = firstDof  ;  partRanges( 1, part ) = endDof  ; }
+    if ( endSlot > firstSlot ){ partRanges( 2, part ) = firstSlot ;  partRanges( 3, part ) = endSlot ; }
+  }
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+// scatterElement
+// =====================================================================
+// adds the forces Finte and the tangent matrix KTe (by columns) of element
+// elem into Fint and valsKT. Entry ind of Finte and KTe is at ind*stride,
+// so that one lane of the batched kernel outputs can be scattered. Fint
+// starts at dof firstDof+1 and valsKT at slot firstSlot+1 (both 0 for the
+// whole vectors, see the partial buffers of assembler).
+void scatterElement( int elem, const uword * dofselemRed, const double * Finte, \
+  const double * KTe, int stride, int paramOut, const assemblyData & assembly, \
+  double * Fint, double * valsKT, uword firstDof, uword firstSlot ){
+
+  // assembly Fint
+  for (int indi=1; indi<= 12; indi++){
+    Fint[ dofselemRed[ indi-1 ]-1 - firstDof ] += Finte[ (indi-1)*stride ] ;
+  }
+  
+  if (paramOut == 2){  
+
+    uword slot;
+    
+    for ( int indj=1; indj<=12; indj++){
+      for ( int indi=1; indi<=12; indi++){
+	  	    
+	slot = assembly.elemSlots.at( (indj-1)*12 + indi-1, elem-1 ) ;
+	
+	if ( slot > 0 ){
+	  valsKT[ slot-1 - firstSlot ] += KTe[ ( (indj-1)*12 + indi-1 )*stride ] ;
+	} // if dofs are in neumdofs
+      } // for rows     
+    } // for cols
+  } // if paramOut 2
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+// tetraDofs
+// =====================================================================
+// translational dofs (1-based, model numbering) of the 4 nodes of
+// tetrahedron elem (0-based)
+void tetraDofs( const modelData & model, uword elem, uword * dofselem ){
+  for ( int ind=1; ind <= 4; ind++ ){
+    for ( int d=1; d <= 3; d++ ){
+      dofselem[ (ind-1)*3 + d-1 ] = model.dofsPerNode*model.elemNodes( elem*4 + ind-1 ) \
+        + model.transDofStep*(d-1) + 1 ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+// assembleGroupElements
+// =====================================================================
+// computes the forces (and the tangent matrices if paramOut == 2) of the
+// nElemsRange elements elems (0-based), all of them of element group group,
+// and adds them into Fint and into the reduced tangent values valsKT, that
+// start at dof firstDof+1 and slot firstSlot+1 (see scatterElement). Only
+// tetrahedra add forces. SVK tetrahedra are computed in batches of
+// tetraBatchWidth by elementTetraSVKBatch (unless assembly.batchedKernel is
+// 0), other materials one by one by elementTetraSolid.
+void assembleGroupElements( const modelData & model, uword group, \
+  const uword * elems, uword nElemsRange, const vec & Ut, int paramOut, \
+  const assemblyData & assembly, double * Fint, double * valsKT, \
+  uword firstDof, uword firstSlot ){
+
+  const mat & materialsParamsMat = model.materialsParamsMat ;
+
+  if ( model.groupType( group ) != 4 ){ return ; } // only tetrahedra add forces
+
+  const int W = tetraBatchWidth ;
+
+  int    consMatFlag = model.groupConsMatFlag( group ) ;
+  int    materialRow = model.groupMaterial( group ) ;
+  bool   svk         = materialsParamsMat( materialRow, 2-1 ) == 2 ;
+  double young       = materialsParamsMat( materialRow, 3-1 ) ;
+  double nu          = materialsParamsMat( materialRow, 4-1 ) ;
+
+  if ( svk && assembly.batchedKernel ){
+    uword  dofselem[ W ][ 4*6/2 ] ;
+    double funder[ 12*W ], vol[ W ], elemDisps[ 12*W ] ;
+    double Finte [ 12*W ], KTe[ 144*W ] ;
+
+    for ( uword first=0; first < nElemsRange; first += W ){
+      int nElemsBatch = min( (uword) W, nElemsRange - first ) ;
+
+      // gather, in structure of arrays form. The lanes after nElemsBatch
+      // repeat the last element and are not scattered.
+      for ( int l=0; l < W; l++){
+        uword elem = elems[ first + min( l, nElemsBatch-1 ) ] ;
+        const double * elemFunder = assembly.elemFunders.colptr( elem ) ;
+        tetraDofs( model, elem, dofselem[ l ] ) ;
+        for ( int ind=0; ind < 12; ind++){
+          funder   [ ind*W + l ] = elemFunder[ ind ] ;
+          elemDisps[ ind*W + l ] = Ut.at( dofselem[ l ][ ind ] - 1 ) ;
+        }
+        vol[ l ] = assembly.elemVols.at( elem ) ;
+      }
+
+      elementTetraSVKBatch( funder, vol, elemDisps, young, nu, paramOut, \
+        consMatFlag, Finte, KTe ) ;
+
+      for ( int l=0; l < nElemsBatch; l++){
+        scatterElement( elems[ first + l ]+1, dofselem[ l ], Finte + l, KTe + l, \
+          W, paramOut, assembly, Fint, valsKT, firstDof, firstSlot ) ;
+      }
+    }
+    return ;
+  }
+
+  uword  dofselem [ 4*6/2 ] ;
+  double elemDisps[ 4*6/2 ] ;
+  vec::fixed<12>     Finte ;
+  mat::fixed<12,12>  KTe   ;
+
+  vec elemConstitutiveParams ;  double elemrho = 0 ;
+  if ( !svk ){
+    vec elemMaterialParams = materialsParamsMat.row( materialRow ).t() ;
+    elemrho                = elemMaterialParams( 1 - 1 ) ;
+    elemConstitutiveParams = elemMaterialParams.rows( 2-1 , elemMaterialParams.n_elem-1 ) ;
+  }
+
+  for ( uword k=0; k < nElemsRange; k++){
+    uword elem = elems[ k ] ;
+    tetraDofs( model, elem, dofselem ) ;
+    for ( int ind=0; ind < 12; ind++){ elemDisps[ ind ] = Ut.at( dofselem[ ind ] - 1 ) ; }
+
+    if ( svk ){ // Saint-Venant-Kirchhoff
+      elementTetraSVK( assembly.elemFunders.colptr( elem ), assembly.elemVols( elem ), \
+        elemDisps, young, nu, paramOut, consMatFlag, Finte, KTe ) ;
+    }else{
+      mat funder = reshape( assembly.elemFunders.col( elem ), 4, 3 ) ;
+      vec Fintegen( 12, fill::zeros ) ;  mat KTegen( 12, 12, fill::zeros ) ;
+      elementTetraSolid( funder, assembly.elemVols( elem ), vec( elemDisps, 12 ), \
+        elemConstitutiveParams, paramOut, consMatFlag, elemrho, Fintegen, KTegen ) ;
+      Finte = Fintegen ;  KTe = KTegen ;
+    }
+
+    scatterElement( elem+1, dofselem, Finte.memptr(), KTe.memptr(), 1, paramOut, \
+      assembly, Fint, valsKT, firstDof, firstSlot ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+// elementTangents
+// =====================================================================
+// internal forces and tangent matrices of the elements elems[0 ...
+// nElemsRange-1] of a group, not assembled: element elems[k] in Finte( 12*k
+// ... ) and KTe( 144*k ... ) (column major). Zero for the groups that are not
+// tetrahedra.
+void elementTangents( const modelData & model, uword group, const uword * elems, \
+  uword nElemsRange, const vec & Ut, const assemblyData & assembly, \
+  double * Finte, double * KTe ){
+
+  const mat & materialsParamsMat = model.materialsParamsMat ;
+
+  if ( model.groupType( group ) != 4 ){
+    std::fill( Finte, Finte + 12*nElemsRange, 0.0 ) ;
+    std::fill( KTe  , KTe  + 144*nElemsRange, 0.0 ) ;
+    return ;
+  }
+
+  const int W = tetraBatchWidth ;
+
+  int    consMatFlag = model.groupConsMatFlag( group ) ;
+  int    materialRow = model.groupMaterial( group ) ;
+  bool   svk         = materialsParamsMat( materialRow, 2-1 ) == 2 ;
+  double young       = materialsParamsMat( materialRow, 3-1 ) ;
+  double nu          = materialsParamsMat( materialRow, 4-1 ) ;
+
+  uword dofselem[ 4*6/2 ] ;
+
+  if ( svk && assembly.batchedKernel ){
+    double funder[ 12*W ], vol[ W ], elemDisps[ 12*W ] ;
+    double FinteBatch[ 12*W ], KTeBatch[ 144*W ] ;
+
+    for ( uword first=0; first < nElemsRange; first += W ){
+      int nElemsBatch = min( (uword) W, nElemsRange - first ) ;
+
+      for ( int l=0; l < W; l++){
+        uword elem = elems[ first + min( l, nElemsBatch-1 ) ] ;
+        const double * elemFunder = assembly.elemFunders.colptr( elem ) ;
+        tetraDofs( model, elem, dofselem ) ;
+        for ( int ind=0; ind < 12; ind++){
+          funder   [ ind*W + l ] = elemFunder[ ind ] ;
+          elemDisps[ ind*W + l ] = Ut.at( dofselem[ ind ] - 1 ) ;
+        }
+        vol[ l ] = assembly.elemVols.at( elem ) ;
+      }
+
+      elementTetraSVKBatch( funder, vol, elemDisps, young, nu, 2, consMatFlag, \
+        FinteBatch, KTeBatch ) ;
+
+      for ( int l=0; l < nElemsBatch; l++){
+        for ( int ind=0; ind < 12; ind++){
+          Finte[ 12*(first+l) + ind ] = FinteBatch[ ind*W + l ] ;
+        }
+        for ( int ind=0; ind < 144; ind++){
+          KTe[ 144*(first+l) + ind ] = KTeBatch[ ind*W + l ] ;
+        }
+      }
+    }
+    return ;
+  }
+
+  double elemDisps[ 4*6/2 ] ;
+  vec::fixed<12>     FinteElem ;
+  mat::fixed<12,12>  KTeElem   ;
+
+  vec elemConstitutiveParams ;  double elemrho = 0 ;
+  if ( !svk ){
+    vec elemMaterialParams = materialsParamsMat.row( materialRow ).t() ;
+    elemrho                = elemMaterialParams( 1 - 1 ) ;
+    elemConstitutiveParams = elemMaterialParams.rows( 2-1 , elemMaterialParams.n_elem-1 ) ;
+  }
+
+  for ( uword k=0; k < nElemsRange; k++){
+    uword elem = elems[ k ] ;
+    tetraDofs( model, elem, dofselem ) ;
+    for ( int ind=0; ind < 12; ind++){ elemDisps[ ind ] = Ut.at( dofselem[ ind ] - 1 ) ; }
+
+    if ( svk ){
+      elementTetraSVK( assembly.elemFunders.colptr( elem ), assembly.elemVols( elem ), \
+        elemDisps, young, nu, 2, consMatFlag, FinteElem, KTeElem ) ;
+    }else{
+      mat funder = reshape( assembly.elemFunders.col( elem ), 4, 3 ) ;
+      vec Fintegen( 12, fill::zeros ) ;  mat KTegen( 12, 12, fill::zeros ) ;
+      elementTetraSolid( funder, assembly.elemVols( elem ), vec( elemDisps, 12 ), \
+        elemConstitutiveParams, 2, consMatFlag, elemrho, Fintegen, KTegen ) ;
+      FinteElem = Fintegen ;  KTeElem = KTegen ;
+    }
+    std::copy( FinteElem.memptr(), FinteElem.memptr() + 12 , Finte + 12*k  ) ;
+    std::copy( KTeElem  .memptr(), KTeElem  .memptr() + 144, KTe   + 144*k ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =====================================================================
+// assembler
+// =====================================================================
+// forces at Ut written in fs (resized if needed, so that buffers are reused
+// across calls) and, if paramOut == 2, reduced tangent matrix in ks(0,0)
+void assembler( const modelData & model, const assemblyData & assembly, \
+  const vec & Ut, const vec & Udott, const vec & Udotdott, int paramOut, \
+  field<vec> & fs, field<sp_mat> & ks ){
+  
+  // ====================================================================
+  //  --- 1 declarations ---
+  // ====================================================================
+
+  // -----------------------------------------------
+  int nElems  = model.nElems ;
+  int nDofs   = numel( Ut ) ;
+  
+  if ( fs.n_elem < 3 ){ fs.set_size( 3, 1 ) ; }
+  if ( ks.n_elem < 3 ){ ks.set_size( 3, 1 ) ; }
+  vec & Fint = fs(0,0) ;  Fint.zeros( nDofs ) ;
+  vec & Fvis = fs(1,0) ;  Fvis.zeros( nDofs ) ;
+  vec & Fmas = fs(2,0) ;  Fmas.zeros( nDofs ) ;
+  
+  if (paramOut == 1){
+    //~ // -------  residual forces vector ------------------------------------
+    //~ // --- creates Fint vector ---
+   }
+   
+  // values of the reduced tangent matrix, in the precomputed CSC pattern
+  vec valsKT ;
+  if (paramOut == 2){
+    valsKT.zeros( assembly.rowInds.n_elem ) ;
+  }
+
+  const uword * groupElems = model.groupElems.memptr() ;
+  uword nGroups = model.groupPtrs.n_elem - 1 ;
+
+  if ( assembly.strategy == 2 ){
+    // partial buffers: the elements, in group order, are split in nParts
+    // fixed contiguous parts, each one accumulated in its own buffer by any
+    // thread. The buffers are summed in part order, so the result does not
+    // depend on the number of threads. The buffer of a part only covers the
+    // forces and values ranges written by its elements (see
+    // computePartRanges), or all of them when the ranges were not computed.
+    int nParts = assembly.nParts ;
+    bool ranged = assembly.partRanges.n_cols == (uword) nParts ;
+    umat ranges( 4, nParts ) ;
+    for ( int part=0; part < nParts; part++){
+      ranges( 0, part ) = ranged ? assembly.partRanges( 0, part ) : 0 ;
+      ranges( 1, part ) = ranged ? assembly.partRanges( 1, part ) : Fint.n_elem ;
+      ranges( 2, part ) = ranged ? assembly.partRanges( 2, part ) : 0 ;
+      ranges( 3, part ) = ranged ? assembly.partRanges( 3, part ) : valsKT.n_elem ;
+      if ( paramOut != 2 ){ ranges( 3, part ) = ranges( 2, part ) ; }
+    }
+
+    // forces and values of part p at bufferPtrs( p ), one after the other
+    uvec bufferPtrs( nParts+1 ) ;
+    bufferPtrs( 0 ) = 0 ;
+    for ( int part=0; part < nParts; part++){
+      bufferPtrs( part+1 ) = bufferPtrs( part ) + ranges( 1, part ) - ranges( 0, part ) \
+                                                 + ranges( 3, part ) - ranges( 2, part ) ;
+    }
+    vec buffers( bufferPtrs( nParts ), fill::zeros ) ;
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for ( int part=0; part < nParts; part++ ){
+      uword partStart = ( (uword) nElems *  part    ) / nParts ;
+      uword partEnd   = ( (uword) nElems * (part+1) ) / nParts ;
+      // buffers of the dofs from ranges( 0, part )+1 and of the slots from
+      // ranges( 2, part )+1
+      double * FintPart = buffers.memptr() + bufferPtrs( part ) ;
+      double * valsPart = FintPart + ranges( 1, part ) - ranges( 0, part ) ;
+      for ( uword group=0; group < nGroups; group++){
+        uword first = max( partStart, model.groupPtrs( group   ) ) ;
+        uword last  = min( partEnd  , model.groupPtrs( group+1 ) ) ;
+        if ( first < last ){
+          assembleGroupElements( model, group, groupElems + first, last - first, \
+            Ut, paramOut, assembly, FintPart, valsPart, ranges( 0, part ), \
+            ranges( 2, part ) ) ;
+        }
+      }
+    }
+
+    for ( int part=0; part < nParts; part++){
+      const double * FintPart = buffers.memptr() + bufferPtrs( part ) ;
+      const double * valsPart = FintPart + ranges( 1, part ) - ranges( 0, part ) ;
+      long long firstDof  = ranges( 0, part ), nDofsPart  = ranges( 1, part ) - firstDof ;
+      long long firstSlot = ranges( 2, part ), nSlotsPart = ranges( 3, part ) - firstSlot ;
+      #pragma omp parallel for schedule(static)
+      for ( long long i=0; i < nDofsPart; i++){ Fint( firstDof + i ) += FintPart[ i ] ; }
+      #pragma omp parallel for schedule(static)
+      for ( long long i=0; i < nSlotsPart; i++){ valsKT( firstSlot + i ) += valsPart[ i ] ; }
+    }
+
+  }else if ( assembly.strategy == 1 ){
+    // coloring: the elements of a color do not share nodes, colors are
+    // assembled one after the other, in batches of tetraBatchWidth elements
+    for ( uword color=1; color < assembly.colorPtrs.n_elem; color++){
+      long long first    = assembly.colorPtrs( color-1 ) ;
+      long long nInColor = assembly.colorPtrs( color ) - first ;
+      long long nBatches = ( nInColor + tetraBatchWidth - 1 ) / tetraBatchWidth ;
+      #pragma omp parallel for schedule(static)
+      for ( long long batch=0; batch < nBatches; batch++){
+        long long nElemsBatch = min( (long long) tetraBatchWidth, nInColor - batch*tetraBatchWidth ) ;
+        assembleGroupElements( model, assembly.colorGroups( color-1 ), \
+          assembly.colorElems.memptr() + first + batch*tetraBatchWidth, nElemsBatch, \
+          Ut, paramOut, assembly, Fint.memptr(), valsKT.memptr(), 0, 0 ) ;
+      }
+    }
+
+  }else{
+    for ( uword group=0; group < nGroups; group++){
+      assembleGroupElements( model, group, groupElems + model.groupPtrs( group ), \
+        model.groupPtrs( group+1 ) - model.groupPtrs( group ), Ut, paramOut, \
+        assembly, Fint.memptr(), valsKT.memptr(), 0, 0 ) ;
+    } // for groups
+  }
+  // -------------------------------------------------------------------  
+
+  if (paramOut == 2){
+    ks(0,0) = sp_mat( assembly.rowInds, assembly.colPtrs, valsKT, \
+      model.neumdofs.n_elem, model.neumdofs.n_elem ) ;
+  }
+}
+// =============================================================================
@@ -0,0 +1,358 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// binary container of the matrices exchanged with ONSAS, instead of the
+// ASCII .dat files. Layout, little endian, version dataFileVersion:
+//
+//   header (64 bytes): magic "ONSASPPB", version, byte order mark 0x01020304,
+//                      number of sections, offset of the sections table
+//   sections table   : one dataFileEntry (96 bytes) per section
+//   data             : of each section, starting at a multiple of 64 bytes.
+//                      Dense matrices: nRows*nCols doubles, column major.
+//                      Index matrices (version 2): nRows*nCols uint64.
+//                      Sparse matrices: nCols+1 column pointers and nnz row
+//                      indices (uint64, 0-based), each aligned, and nnz values.
+//                      The empty sections have no data.
+//
+// The values are the bits of the doubles, so the results of a run written
+// and read back give the same restart. The file is read by mapping it in
+// memory: the dense and index sections are used in place by the matrices
+// given by dataFileMat, dataFileVec and dataFileUmat, with private (copy on
+// write) pages.
+
+#include "onsaspp.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std  ;
+using namespace arma ;
+
+static const char     dataFileMagic[8] = { 'O','N','S','A','S','P','P','B' } ;
+static const uint32_t dataFileVersion  = 2 ;
+static const uint32_t dataFileByteOrder = 0x01020304 ;
+static const uint64_t dataFileAlign    = 64 ;
+
+struct dataFileHeader {
+  char     magic[8] ;
+  uint32_t version, byteOrder ;
+  uint64_t nSections, tableOffset ;
+  uint8_t  reserved[32] ;
+};
+
+struct dataFileEntry {
+  char     name[40] ;
+  uint32_t type, reserved ; // 0 dense, 1 sparse, 2 index
+  uint64_t nRows, nCols, nnz ;
+  uint64_t offset, bytes ;  // of the data of the section
+  uint64_t reserved2 ;
+};
+
+static_assert( sizeof( dataFileHeader ) == 64, "dataFileHeader layout" ) ;
+static_assert( sizeof( dataFileEntry  ) == 96, "dataFileEntry layout"  ) ;
+// the indices of the sparse sections are those of arma::sp_mat
+static_assert( sizeof( uword ) == sizeof( uint64_t ), "64 bit arma::uword needed (ARMA_64BIT_WORD)" ) ;
+
+static uint64_t alignUp( uint64_t bytes ){
+  return ( bytes + dataFileAlign - 1 ) / dataFileAlign * dataFileAlign ;
+}
+
+// bytes of the column pointers and row indices of a sparse section, aligned
+static void sparseSectionBytes( uint64_t nCols, uint64_t nnz, uint64_t & colPtrsBytes, \
+  uint64_t & rowIndsBytes ){
+  colPtrsBytes = alignUp( ( nCols + 1 ) * sizeof( uint64_t ) ) ;
+  rowIndsBytes = alignUp( nnz * sizeof( uint64_t ) ) ;
+}
+
+
+
+// =============================================================================
+// --- dataFileAddMat / dataFileAddUmat / dataFileAddSpMat ---
+// =============================================================================
+// sections of a file to be written by dataFileSave. The matrices are not
+// copied and are kept by the caller until then.
+void dataFileAddMat( dataFile & file, const string & name, const mat & M ){
+
+  dataFileSection section ;
+  section.name   = name ;
+  section.type   = 0 ;
+  section.nRows  = M.n_rows ;
+  section.nCols  = M.n_cols ;
+  section.nnz    = M.n_elem ;
+  section.values = M.memptr() ;
+  file.sections.push_back( section ) ;
+}
+
+void dataFileAddUmat( dataFile & file, const string & name, const umat & M ){
+
+  dataFileSection section ;
+  section.name    = name ;
+  section.type    = 2 ;
+  section.nRows   = M.n_rows ;
+  section.nCols   = M.n_cols ;
+  section.nnz     = M.n_elem ;
+  section.indices = M.memptr() ;
+  file.sections.push_back( section ) ;
+}
+
+void dataFileAddSpMat( dataFile & file, const string & name, const sp_mat & A ){
+
+  A.sync() ;
+  dataFileSection section ;
+  section.name    = name ;
+  section.type    = 1 ;
+  section.nRows   = A.n_rows ;
+  section.nCols   = A.n_cols ;
+  section.nnz     = A.n_nonzero ;
+  section.values  = A.values ;
+  section.colPtrs = A.col_ptrs ;
+  section.rowInds = A.row_indices ;
+  file.sections.push_back( section ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- dataFileSave ---
+// =============================================================================
+// writes the sections added to file in the binary container path
+void dataFileSave( const string & path, const dataFile & file ){
+
+  uint64_t nSections = file.sections.size() ;
+  vector<dataFileEntry> table( nSections ) ;
+
+  uint64_t offset = alignUp( sizeof( dataFileHeader ) + nSections * sizeof( dataFileEntry ) ) ;
+  for ( uword s=0; s < nSections; s++){
+    const dataFileSection & section = file.sections[ s ] ;
+    dataFileEntry & entry = table[ s ] ;
+    memset( &entry, 0, sizeof( entry ) ) ;
+    if ( section.name.size() >= sizeof( entry.name ) ){
+      throw runtime_error( "dataFileSave: section name too long: " + section.name ) ;
+    }
+    memcpy( entry.name, section.name.c_str(), section.name.size() ) ;
+    entry.type   = section.type  ;
+    entry.nRows  = section.nRows ;
+    entry.nCols  = section.nCols ;
+    entry.nnz    = section.nnz   ;
+    entry.offset = offset ;
+    entry.bytes  = section.nnz * sizeof( double ) ;
+    if ( section.type == 1 ){
+      uint64_t colPtrsBytes, rowIndsBytes ;
+      sparseSectionBytes( section.nCols, section.nnz, colPtrsBytes, rowIndsBytes ) ;
+      entry.bytes += colPtrsBytes + rowIndsBytes ;
+    }
+    offset = alignUp( offset + entry.bytes ) ;
+  }
+
+  dataFileHeader header ;
+  memset( &header, 0, sizeof( header ) ) ;
+  memcpy( header.magic, dataFileMagic, sizeof( dataFileMagic ) ) ;
+  header.version     = dataFileVersion ;
+  header.byteOrder   = dataFileByteOrder ;
+  header.nSections   = nSections ;
+  header.tableOffset = sizeof( dataFileHeader ) ;
+
+  ofstream out( path, ios::binary | ios::trunc ) ;
+  if ( !out ){ throw runtime_error( "dataFileSave: can not write " + path ) ; }
+
+  const char zeros[ dataFileAlign ] = { 0 } ;
+  uint64_t written = 0 ;
+  auto pad = [ & ]( uint64_t to ){ out.write( zeros, to - written ) ;  written = to ; } ;
+  auto put = [ & ]( const void * data, uint64_t bytes ){
+    out.write( static_cast<const char *>( data ), bytes ) ;  written += bytes ;
+  } ;
+
+  put( &header, sizeof( header ) ) ;
+  put( table.data(), nSections * sizeof( dataFileEntry ) ) ;
+
+  for ( uword s=0; s < nSections; s++){
+    const dataFileSection & section = file.sections[ s ] ;
+    pad( table[ s ].offset ) ;
+    if ( section.type == 1 ){
+      uint64_t colPtrsBytes, rowIndsBytes ;
+      sparseSectionBytes( section.nCols, section.nnz, colPtrsBytes, rowIndsBytes ) ;
+      put( section.colPtrs, ( section.nCols + 1 ) * sizeof( uword ) ) ;
+      pad( table[ s ].offset + colPtrsBytes ) ;
+      put( section.rowInds, section.nnz * sizeof( uword ) ) ;
+      pad( table[ s ].offset + colPtrsBytes + rowIndsBytes ) ;
+    }
+    if ( section.type == 2 ){ put( section.indices, section.nnz * sizeof( uword ) ) ; }
+    else{ put( section.values, section.nnz * sizeof( double ) ) ; }
+  }
+  pad( alignUp( written ) ) ;
+
+  if ( !out ){ throw runtime_error( "dataFileSave: error writing " + path ) ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- dataFileOpen ---
+// =============================================================================
+// maps the binary container path in memory and reads its sections table.
+// Returns false if the file does not exist, and throws if it is not a
+// container of a version that can be read.
+bool dataFileOpen( const string & path, dataFile & file ){
+
+  dataFileClose( file ) ;
+
+  int fd = open( path.c_str(), O_RDONLY ) ;
+  if ( fd < 0 ){ return false ; }
+
+  struct stat status ;
+  if ( fstat( fd, &status ) != 0 || uint64_t( status.st_size ) < sizeof( dataFileHeader ) ){
+    close( fd ) ;
+    throw runtime_error( "dataFileOpen: not a binary container: " + path ) ;
+  }
+  size_t bytes = status.st_size ;
+  // private pages: the matrices using the mapped sections may be modified
+  void * map = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 ) ;
+  close( fd ) ;
+  if ( map == MAP_FAILED ){ throw runtime_error( "dataFileOpen: can not map " + path ) ; }
+  file.map      = map   ;
+  file.mapBytes = bytes ;
+
+  const char * base = static_cast<const char *>( map ) ;
+  dataFileHeader header ;
+  memcpy( &header, base, sizeof( header ) ) ;
+  if ( memcmp( header.magic, dataFileMagic, sizeof( dataFileMagic ) ) != 0 \
+       || header.byteOrder != dataFileByteOrder \
+       || header.tableOffset + header.nSections * sizeof( dataFileEntry ) > bytes ){
+    dataFileClose( file ) ;
+    throw runtime_error( "dataFileOpen: not a binary container: " + path ) ;
+  }
+  if ( header.version > dataFileVersion ){
+    dataFileClose( file ) ;
+    throw runtime_error( "dataFileOpen: version " + to_string( header.version ) \
+      + " not supported: " + path ) ;
+  }
+
+  for ( uword s=0; s < header.nSections; s++){
+    dataFileEntry entry ;
+    memcpy( &entry, base + header.tableOffset + s * sizeof( dataFileEntry ), sizeof( entry ) ) ;
+    entry.name[ sizeof( entry.name ) - 1 ] = 0 ;
+
+    uint64_t colPtrsBytes = 0, rowIndsBytes = 0 ;
+    if ( entry.type == 1 ){ sparseSectionBytes( entry.nCols, entry.nnz, colPtrsBytes, rowIndsBytes ) ; }
+    if ( entry.type > 2 || entry.offset % dataFileAlign != 0 || entry.offset + entry.bytes > bytes \
+         || entry.bytes != colPtrsBytes + rowIndsBytes + entry.nnz * sizeof( double ) \
+         || ( entry.type != 1 && entry.nnz != entry.nRows * entry.nCols ) ){
+      dataFileClose( file ) ;
+      throw runtime_error( "dataFileOpen: corrupt section " + string( entry.name ) + " of " + path ) ;
+    }
+
+    dataFileSection section ;
+    section.name  = entry.name  ;
+    section.type  = entry.type  ;
+    section.nRows = entry.nRows ;
+    section.nCols = entry.nCols ;
+    section.nnz   = entry.nnz   ;
+    const char * data = base + entry.offset ;
+    if ( entry.type == 2 ){
+      section.indices = reinterpret_cast<const uword *>( data ) ;
+    }else{
+      section.values = reinterpret_cast<const double *>( data + colPtrsBytes + rowIndsBytes ) ;
+    }
+    if ( entry.type == 1 ){
+      section.colPtrs = reinterpret_cast<const uword *>( data ) ;
+      section.rowInds = reinterpret_cast<const uword *>( data + colPtrsBytes ) ;
+    }
+    file.sections.push_back( section ) ;
+  }
+  return true ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- dataFileClose ---
+// =============================================================================
+// unmaps the file. The matrices using its sections must not be used after.
+void dataFileClose( dataFile & file ){
+  if ( file.map != nullptr ){ munmap( file.map, file.mapBytes ) ; }
+  file.map      = nullptr ;
+  file.mapBytes = 0 ;
+  file.sections.clear() ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- dataFileFind ---
+// =============================================================================
+// section name of the file, nullptr if there is none
+const dataFileSection * dataFileFind( const dataFile & file, const string & name ){
+  for ( const dataFileSection & section : file.sections ){
+    if ( section.name == name ){ return &section ; }
+  }
+  return nullptr ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- dataFileMat / dataFileVec / dataFileUmat / dataFileSpMat ---
+// =============================================================================
+// matrices of the sections of an open file, empty if there is no section
+// name. The dense and index ones use the mapped memory (not strict: they allocate their
+// own memory when they change size), the sparse one is built from its
+// compressed columns.
+mat dataFileMat( const dataFile & file, const string & name ){
+  const dataFileSection * section = dataFileFind( file, name ) ;
+  if ( section == nullptr || section->type != 0 ){ return mat() ; }
+  return mat( const_cast<double *>( section->values ), section->nRows, section->nCols, false, false ) ;
+}
+
+vec dataFileVec( const dataFile & file, const string & name ){
+  const dataFileSection * section = dataFileFind( file, name ) ;
+  if ( section == nullptr || section->type != 0 ){ return vec() ; }
+  return vec( const_cast<double *>( section->values ), section->nnz, false, false ) ;
+}
+
+umat dataFileUmat( const dataFile & file, const string & name ){
+  const dataFileSection * section = dataFileFind( file, name ) ;
+  if ( section == nullptr || section->type != 2 ){ return umat() ; }
+  return umat( const_cast<uword *>( section->indices ), section->nRows, section->nCols, false, false ) ;
+}
+
+sp_mat dataFileSpMat( const dataFile & file, const string & name ){
+  const dataFileSection * section = dataFileFind( file, name ) ;
+  if ( section == nullptr || section->type != 1 ){ return sp_mat() ; }
+
+  uvec colPtrs( const_cast<uword *>( section->colPtrs ), section->nCols + 1, false, true ) ;
+  uvec rowInds( const_cast<uword *>( section->rowInds ), section->nnz, false, true ) ;
+  return sp_mat( rowInds, colPtrs, vec( const_cast<double *>( section->values ), \
+    section->nnz, false, true ), section->nRows, section->nCols ) ;
+}
+// =============================================================================
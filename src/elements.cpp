@@ -0,0 +1,424 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+#include <stdexcept>
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// shapeFunsDeriv
+// =============================================================================
+mat shapeFunsDeriv ( double x, double y, double z ){
+  mat fun = zeros<mat>( 4, 3 ) ;
+  fun( 0, 0 ) =  1 ;
+  fun( 1, 0 ) = -1 ;
+  fun( 1, 1 ) = -1 ;
+  fun( 1, 2 ) = -1 ;
+  fun( 2, 2 ) =  1 ;
+  fun( 3, 1 ) =  1 ;
+  return fun;
+}
+// ======================================================================
+
+
+
+
+// ======================================================================
+// cosseratSVK
+// ======================================================================
+void cosseratSVK ( const vec & consParams, const mat & Egreen, int consMatFlag, mat & S, mat & ConsMat ){
+
+  double young  = consParams(1-1) ;
+  double nu     = consParams(2-1) ;
+  
+  double lambda = young * nu / ( (1 + nu) * (1 - 2*nu) ) ;
+  double shear  = young      / ( 2 * (1 + nu) )          ;
+  
+  S      = lambda * trace(Egreen) * eye(3,3) + 2 * shear * Egreen ;
+  ConsMat.zeros();
+
+  if (consMatFlag == 1){ // complex-step computation expression
+    //~ //ConsMat = zeros(6,6);
+    //~ //ConsMat = complexStepConsMat( 'cosseratSVK', consParams, Egreen ) ;
+  }else if (consMatFlag == 2){ // analytical expression
+    ConsMat (1-1,1-1) = ( shear / (1 - 2 * nu) ) * 2 * ( 1-nu  ) ; 
+    ConsMat (1-1,2-1) = ( shear / (1 - 2 * nu) ) * 2 * (   nu  ) ; 
+    ConsMat (1-1,3-1) = ( shear / (1 - 2 * nu) ) * 2 * (   nu  ) ; 
+  
+    ConsMat (2-1,1-1) = ( shear / (1 - 2 * nu) ) * 2 * (    nu ) ;
+    ConsMat (2-1,2-1) = ( shear / (1 - 2 * nu) ) * 2 * (  1-nu ) ;
+    ConsMat (2-1,3-1) = ( shear / (1 - 2 * nu) ) * 2 * (    nu ) ;
+    
+    ConsMat (3-1,1-1) = ( shear / (1 - 2 * nu) ) * 2 * (   nu ) ;
+    ConsMat (3-1,2-1) = ( shear / (1 - 2 * nu) ) * 2 * (   nu ) ;
+    ConsMat (3-1,3-1) = ( shear / (1 - 2 * nu) ) * 2 * ( 1-nu ) ;
+    
+    ConsMat (4-1,4-1 ) = shear ;
+    ConsMat (5-1,5-1 ) = shear ;
+    ConsMat (6-1,6-1 ) = shear ;
+  }
+}
+// ==============================================================================
+
+
+
+
+// ======================================================================
+// BgrandeMats
+// ======================================================================
+mat BgrandeMats ( const mat & deriv , const mat & F ){
+
+  mat matBgrande = zeros<mat>(6, 12);
+  
+  for (int k=1; k<=4; k++){
+
+    for (int i=1; i<=3 ; i++){
+
+      for (int j=1; j<=3; j++){
+        matBgrande ( i-1 , (k-1)*3 + j -1  ) = deriv(i-1,k-1) * F(j-1,i-1) ;
+      }
+    }          
+
+    for (int j=1; j<=3; j++){
+      matBgrande ( 4-1 , (k-1)*3 + j-1 ) = deriv(2-1,k-1) * F(j-1,3-1) + deriv(3-1,k-1) * F(j-1,2-1) ;
+      matBgrande ( 5-1 , (k-1)*3 + j-1 ) = deriv(1-1,k-1) * F(j-1,3-1) + deriv(3-1,k-1) * F(j-1,1-1) ;
+      matBgrande ( 6-1 , (k-1)*3 + j-1 ) = deriv(1-1,k-1) * F(j-1,2-1) + deriv(2-1,k-1) * F(j-1,1-1) ;
+    }
+  } // for j
+  return matBgrande;
+}
+// ======================================================================
+
+
+// ======================================================================
+vec mat2voigt( const mat & Tensor, double factor ){
+    
+  vec v = zeros<vec>(6);
+    
+  v(1-1) = Tensor(1-1,1-1) ;
+  v(2-1) = Tensor(2-1,2-1) ;
+  v(3-1) = Tensor(3-1,3-1) ;
+  v(4-1) = Tensor(2-1,3-1)*factor ;
+  v(5-1) = Tensor(1-1,3-1)*factor ;
+  v(6-1) = Tensor(1-1,2-1)*factor ;
+  
+  return v;
+}
+// ======================================================================
+
+
+
+// ======================================================================
+//
+//~ // ======================================================================
+//~ mat constTensor ( vec hyperElasParamsVec, mat Egreen ){
+
+  //~ mat ConsMat = zeros<mat> (6,6);
+  
+  //~ double young = hyperElasParamsVec(0)       ;
+  //~ double nu = hyperElasParamsVec(1)          ;
+  //~ double shear   = young / ( 2.0 * (1+ nu) ) ;
+
+
+  //~ return ConsMat;
+//~ }
+//~ // ======================================================================
+
+
+
+
+
+// =====================================================================
+//  tetraGeometry
+// =====================================================================
+// reference configuration quantities of a tetrahedron: derivatives of the
+// shape functions with respect to the material coordinates and volume
+void tetraGeometry( const vec & elemCoords, mat & funder, double & vol ){
+
+  mat eleCoordMat = reshape( elemCoords, 3, 4 ) ;
+
+  // matriz de derivadas de fun forma respecto a coordenadas isoparametricas
+  double xi = 0.25 ;  double wi = 1.0 / 6.0  ;
+  mat deriv = shapeFunsDeriv( xi, xi , xi ) ;
+
+  // jacobiano que relaciona coordenadas materiales con isoparametricas
+  mat jacobianmat = eleCoordMat * deriv  ;
+
+  vol = det( jacobianmat ) * wi ;
+
+  funder = deriv * inv(jacobianmat) ;
+}
+// =====================================================================
+
+
+
+
+// =====================================================================
+//  computeElemGeometry
+// =====================================================================
+// precomputes, once per run, the reference geometry of the tetrahedra.
+// elemFunders.col( elem-1 ) stores funder (4x3, by columns) and
+// elemVols( elem-1 ) the volume. Meshes with negative volume elements are
+// rejected here, before any iteration, with a runtime_error.
+void computeElemGeometry( const modelData & model, mat & elemFunders, vec & elemVols ){
+
+  elemFunders.zeros( 4*3, model.nElems ) ;
+  elemVols.zeros( model.nElems ) ;
+
+  vec elemCoords( 4*6/2 ) ;
+  mat funder ;
+  double vol ;
+
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    if ( model.groupType( group ) != 4 ){ continue ; }
+
+    for ( uword k=model.groupPtrs( group ); k < model.groupPtrs( group+1 ); k++){
+      int elem = model.groupElems( k ) + 1 ;
+
+      for ( int ind=1; ind <= 4; ind++ ){
+        int node = model.elemNodes( (elem-1)*4 + ind-1 ) ;
+        elemCoords( (ind-1)*3 + 1-1 ) = model.nodeCoordsX( node ) ;
+        elemCoords( (ind-1)*3 + 2-1 ) = model.nodeCoordsY( node ) ;
+        elemCoords( (ind-1)*3 + 3-1 ) = model.nodeCoordsZ( node ) ;
+      }
+
+      tetraGeometry( elemCoords, funder, vol ) ;
+
+      if (vol<0){
+        throw runtime_error( "computeElemGeometry: element " + to_string( elem ) \
+          + " with negative volume " + to_string( vol ) + ", check connectivity." ) ;
+      }
+
+      elemFunders.col( elem-1 ) = vectorise( funder ) ;
+      elemVols( elem-1 )        = vol ;
+    } // for elements of the group
+  } // for groups
+}
+// =====================================================================
+
+
+
+
+// =====================================================================
+//  elementTetraSVKSolidInternLoadsTangMat
+// =====================================================================
+// funder and vol are the reference geometry given by computeElemGeometry
+void elementTetraSolid( const mat & funder, double vol, const vec & elemDisps, \
+    const vec & elemConstitutiveParams, int paramOut, int consMatFlag, \
+    double elemrho, vec & Finte, mat & KTe ){
+  
+    // reset element forces
+  Finte.zeros();  KTe.zeros();
+
+  mat eleDispsMat = reshape( elemDisps , 3, 4 ) ;
+
+  // displacement gradient
+  mat H = eleDispsMat * funder ;
+  mat F = H + eye(3,3) ;
+  mat Egreen = 0.5 * ( H + H.t() + H.t() * H ) ;
+
+  mat S, ConsMat(6,6);
+  
+  if (elemConstitutiveParams(1-1) == 2){ // Saint-Venant-Kirchhoff compressible solid
+    cosseratSVK( elemConstitutiveParams(span(2-1,3-1)), Egreen, consMatFlag, S, ConsMat );
+  //~ }else if (elemConstitutiveParams(1-1) == 3){ // Neo-Hookean Compressible
+    //~ [ S, ConsMat ] = cosseratNH ( elemConstitutiveParams(2:3), Egreen, consMatFlag ) ;
+  }
+
+  mat matBgrande = BgrandeMats ( funder.t() , F ) ;
+
+  vec Svoigt = mat2voigt( S, 1 ) ;
+
+  Finte  = matBgrande.t() * Svoigt * vol ;
+
+  if (paramOut == 2){
+    mat Kml        = matBgrande.t() * ConsMat * matBgrande * vol ;
+    mat matauxgeom = funder * S * funder.t()  * vol ;
+    mat Kgl        = zeros<mat>(12,12) ;
+    for   (int i=1; i<=4; i++){
+      for (int j=1; j<=4; j++){
+        Kgl( (i-1)*3+1-1 , (j-1)*3+1-1 ) = matauxgeom( i-1, j-1 ) ;
+        Kgl( (i-1)*3+2-1 , (j-1)*3+2-1 ) = matauxgeom( i-1, j-1 ) ;
+        Kgl( (i-1)*3+3-1 , (j-1)*3+3-1 ) = matauxgeom( i-1, j-1 ) ;
+      }
+    }
+    KTe = Kml + Kgl ;
+  }
+
+}
+// =====================================================================
+
+
+
+
+// =====================================================================
+//  elementTetraSVK
+// =====================================================================
+// allocation free version of elementTetraSolid for the Saint-Venant-Kirchhoff
+// material, with all sizes fixed at compile time. The products with
+// BgrandeMats are expanded: Finte = vol * F S g_k for each node k (g_k the
+// gradient of its shape function) and, since ConsMat = lambda m m' + 2 shear
+// diag(1,1,1,.5,.5,.5), ConsMat * matBgrande is formed without the 6x6
+// product. The geometric stiffness only adds to the diagonal of each 3x3
+// block. funder (4x3, by columns) and vol are given by computeElemGeometry.
+void elementTetraSVK( const double * funder, double vol, const double * elemDisps, \
+    double young, double nu, int paramOut, int consMatFlag, \
+    vec::fixed<12> & Finte, mat::fixed<12,12> & KTe ){
+
+  double lambda = young * nu / ( (1 + nu) * (1 - 2*nu) ) ;
+  double shear  = young      / ( 2 * (1 + nu) )          ;
+
+  // displacement gradient H = eleDispsMat * funder and F = H + I
+  double H[3][3], F[3][3] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      double h = 0 ;
+      for (int a=0; a<4; a++){ h += elemDisps[ 3*a+i ] * funder[ a + 4*j ] ; }
+      H[i][j] = h ;
+      F[i][j] = h + ( i == j ) ;
+    }
+  }
+
+  // Green-Lagrange strain and second Piola-Kirchhoff stress
+  double Egreen[3][3], S[3][3] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      double hth = 0 ;
+      for (int k=0; k<3; k++){ hth += H[k][i] * H[k][j] ; }
+      Egreen[i][j] = 0.5 * ( H[i][j] + H[j][i] + hth ) ;
+    }
+  }
+  double trE = Egreen[0][0] + Egreen[1][1] + Egreen[2][2] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      S[i][j] = 2 * shear * Egreen[i][j] + ( i == j ) * lambda * trE ;
+    }
+  }
+
+  // first Piola-Kirchhoff stress P = F S, internal forces Finte_k = vol P g_k
+  double P[3][3] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      P[i][j] = F[i][0] * S[0][j] + F[i][1] * S[1][j] + F[i][2] * S[2][j] ;
+    }
+  }
+  for (int k=0; k<4; k++){
+    for (int j=0; j<3; j++){
+      Finte.at( 3*k+j ) = vol * ( P[j][0] * funder[ k ] + P[j][1] * funder[ k+4 ] \
+                                + P[j][2] * funder[ k+8 ] ) ;
+    }
+  }
+
+  if (paramOut != 2){ return ; }
+
+  // material stiffness: vol * matBgrande' * ConsMat * matBgrande
+  KTe.zeros() ;
+  if (consMatFlag == 2){
+    double B[6][12], CB[6][12] ;
+    for (int k=0; k<4; k++){
+      const double g0 = funder[ k ], g1 = funder[ k+4 ], g2 = funder[ k+8 ] ;
+      for (int j=0; j<3; j++){
+        int c = 3*k+j ;
+        B[0][c] = g0 * F[j][0] ;
+        B[1][c] = g1 * F[j][1] ;
+        B[2][c] = g2 * F[j][2] ;
+        B[3][c] = g1 * F[j][2] + g2 * F[j][1] ;
+        B[4][c] = g0 * F[j][2] + g2 * F[j][0] ;
+        B[5][c] = g0 * F[j][1] + g1 * F[j][0] ;
+
+        double lambdaTrB = lambda * ( B[0][c] + B[1][c] + B[2][c] ) ;
+        CB[0][c] = lambdaTrB + 2 * shear * B[0][c] ;
+        CB[1][c] = lambdaTrB + 2 * shear * B[1][c] ;
+        CB[2][c] = lambdaTrB + 2 * shear * B[2][c] ;
+        CB[3][c] = shear * B[3][c] ;
+        CB[4][c] = shear * B[4][c] ;
+        CB[5][c] = shear * B[5][c] ;
+      }
+    }
+    // symmetric: upper triangle and copy
+    for (int c2=0; c2<12; c2++){
+      for (int c1=0; c1<=c2; c1++){
+        double kij = 0 ;
+        for (int i=0; i<6; i++){ kij += B[i][c1] * CB[i][c2] ; }
+        KTe.at( c1, c2 ) = kij * vol ;
+        KTe.at( c2, c1 ) = kij * vol ;
+      }
+    }
+  }
+
+  // geometric stiffness: vol * g_a' S g_b on the diagonal of block (a,b)
+  for (int a=0; a<4; a++){
+    double Sga[3] ;
+    for (int i=0; i<3; i++){
+      Sga[i] = S[i][0] * funder[ a ] + S[i][1] * funder[ a+4 ] + S[i][2] * funder[ a+8 ] ;
+    }
+    for (int b=0; b<4; b++){
+      double gSg = vol * ( Sga[0] * funder[ b ] + Sga[1] * funder[ b+4 ] \
+                         + Sga[2] * funder[ b+8 ] ) ;
+      KTe.at( 3*a  , 3*b   ) += gSg ;
+      KTe.at( 3*a+1, 3*b+1 ) += gSg ;
+      KTe.at( 3*a+2, 3*b+2 ) += gSg ;
+    }
+  }
+}
+// =====================================================================
+
+
+
+
+// =====================================================================
+//  elementTetraSVKStress
+// =====================================================================
+// second Piola-Kirchhoff stress of a Saint-Venant-Kirchhoff tetrahedron, in
+// the Voigt order of mat2voigt: Svoigt = ( Sxx Syy Szz Syz Sxz Sxy ).
+// funder (4x3, by columns) is given by computeElemGeometry.
+void elementTetraSVKStress( const double * funder, const double * elemDisps, \
+    double young, double nu, double * Svoigt ){
+
+  double lambda = young * nu / ( (1 + nu) * (1 - 2*nu) ) ;
+  double shear  = young      / ( 2 * (1 + nu) )          ;
+
+  double H[3][3] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      double h = 0 ;
+      for (int a=0; a<4; a++){ h += elemDisps[ 3*a+i ] * funder[ a + 4*j ] ; }
+      H[i][j] = h ;
+    }
+  }
+
+  double Egreen[3][3] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      double hth = 0 ;
+      for (int k=0; k<3; k++){ hth += H[k][i] * H[k][j] ; }
+      Egreen[i][j] = 0.5 * ( H[i][j] + H[j][i] + hth ) ;
+    }
+  }
+  double trE = Egreen[0][0] + Egreen[1][1] + Egreen[2][2] ;
+
+  Svoigt[0] = 2 * shear * Egreen[0][0] + lambda * trE ;
+  Svoigt[1] = 2 * shear * Egreen[1][1] + lambda * trE ;
+  Svoigt[2] = 2 * shear * Egreen[2][2] + lambda * trE ;
+  Svoigt[3] = 2 * shear * Egreen[1][2] ;
+  Svoigt[4] = 2 * shear * Egreen[0][2] ;
+  Svoigt[5] = 2 * shear * Egreen[0][1] ;
+}
+// =====================================================================
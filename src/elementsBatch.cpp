@@ -0,0 +1,233 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+using namespace std  ;
+using namespace arma ;
+
+// Batched Saint-Venant-Kirchhoff tetrahedron kernel: the operations of
+// elementTetraSVK applied to tetraBatchWidth elements at once, with the data
+// in structure of arrays form (entry ind of lane l at [ ind*W + l ]). The
+// innermost loops run over the lanes and are vectorised with omp simd. The
+// body is compiled for AVX-512, AVX2 and the baseline instruction set, and
+// the version is selected at run time for the CPU.
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ONSASPP_X86_DISPATCH
+#endif
+
+static const int W = tetraBatchWidth ;
+
+// =============================================================================
+//  tetraSVKBatchBody
+// =============================================================================
+static inline __attribute__((always_inline)) void tetraSVKBatchBody( \
+    const double * funder, const double * vol, const double * elemDisps, \
+    double young, double nu, int paramOut, int consMatFlag, \
+    double * Finte, double * KTe ){
+
+  const double lambda = young * nu / ( (1 + nu) * (1 - 2*nu) ) ;
+  const double shear  = young      / ( 2 * (1 + nu) )          ;
+
+  // displacement gradient and deformation gradient, entry (i,j) at 3*i+j
+  double H[9][W], F[9][W] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        double h = 0 ;
+        for (int a=0; a<4; a++){ h += elemDisps[ (3*a+i)*W + l ] * funder[ (a+4*j)*W + l ] ; }
+        H[3*i+j][l] = h ;
+        F[3*i+j][l] = h + ( i == j ) ;
+      }
+    }
+  }
+
+  // Green-Lagrange strain and second Piola-Kirchhoff stress
+  double S[9][W] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        double hth = H[i][l] * H[j][l] + H[3+i][l] * H[3+j][l] + H[6+i][l] * H[6+j][l] ;
+        S[3*i+j][l] = 0.5 * ( H[3*i+j][l] + H[3*j+i][l] + hth ) ; // Egreen for now
+      }
+    }
+  }
+  #pragma omp simd
+  for (int l=0; l<W; l++){
+    double lambdaTrE = lambda * ( S[0][l] + S[4][l] + S[8][l] ) ;
+    for (int ij=0; ij<9; ij++){ S[ij][l] = 2 * shear * S[ij][l] + ( ij % 4 == 0 ) * lambdaTrE ; }
+  }
+
+  // first Piola-Kirchhoff stress P = F S and internal forces vol P g_k
+  double P[9][W] ;
+  for (int i=0; i<3; i++){
+    for (int j=0; j<3; j++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        P[3*i+j][l] = F[3*i][l] * S[j][l] + F[3*i+1][l] * S[3+j][l] + F[3*i+2][l] * S[6+j][l] ;
+      }
+    }
+  }
+  for (int k=0; k<4; k++){
+    for (int j=0; j<3; j++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        Finte[ (3*k+j)*W + l ] = vol[l] * ( P[3*j][l] * funder[ k*W + l ] \
+          + P[3*j+1][l] * funder[ (k+4)*W + l ] + P[3*j+2][l] * funder[ (k+8)*W + l ] ) ;
+      }
+    }
+  }
+
+  if (paramOut != 2){ return ; }
+
+  for (int ind=0; ind < 144*W; ind++){ KTe[ ind ] = 0 ; }
+
+  // material stiffness
+  if (consMatFlag == 2){
+    double B[6][12][W], CB[6][12][W] ;
+    for (int k=0; k<4; k++){
+      for (int j=0; j<3; j++){
+        int c = 3*k+j ;
+        #pragma omp simd
+        for (int l=0; l<W; l++){
+          double g0 = funder[ k*W + l ], g1 = funder[ (k+4)*W + l ], g2 = funder[ (k+8)*W + l ] ;
+          B[0][c][l] = g0 * F[3*j  ][l] ;
+          B[1][c][l] = g1 * F[3*j+1][l] ;
+          B[2][c][l] = g2 * F[3*j+2][l] ;
+          B[3][c][l] = g1 * F[3*j+2][l] + g2 * F[3*j+1][l] ;
+          B[4][c][l] = g0 * F[3*j+2][l] + g2 * F[3*j  ][l] ;
+          B[5][c][l] = g0 * F[3*j+1][l] + g1 * F[3*j  ][l] ;
+
+          double lambdaTrB = lambda * ( B[0][c][l] + B[1][c][l] + B[2][c][l] ) ;
+          CB[0][c][l] = lambdaTrB + 2 * shear * B[0][c][l] ;
+          CB[1][c][l] = lambdaTrB + 2 * shear * B[1][c][l] ;
+          CB[2][c][l] = lambdaTrB + 2 * shear * B[2][c][l] ;
+          CB[3][c][l] = shear * B[3][c][l] ;
+          CB[4][c][l] = shear * B[4][c][l] ;
+          CB[5][c][l] = shear * B[5][c][l] ;
+        }
+      }
+    }
+    for (int c2=0; c2<12; c2++){
+      for (int c1=0; c1<=c2; c1++){
+        #pragma omp simd
+        for (int l=0; l<W; l++){
+          double kij = 0 ;
+          for (int i=0; i<6; i++){ kij += B[i][c1][l] * CB[i][c2][l] ; }
+          KTe[ (c1 + 12*c2)*W + l ] = kij * vol[l] ;
+          KTe[ (c2 + 12*c1)*W + l ] = kij * vol[l] ;
+        }
+      }
+    }
+  }
+
+  // geometric stiffness
+  for (int a=0; a<4; a++){
+    double Sga[3][W] ;
+    for (int i=0; i<3; i++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        Sga[i][l] = S[3*i][l] * funder[ a*W + l ] + S[3*i+1][l] * funder[ (a+4)*W + l ] \
+                  + S[3*i+2][l] * funder[ (a+8)*W + l ] ;
+      }
+    }
+    for (int b=0; b<4; b++){
+      #pragma omp simd
+      for (int l=0; l<W; l++){
+        double gSg = vol[l] * ( Sga[0][l] * funder[ b*W + l ] + Sga[1][l] * funder[ (b+4)*W + l ] \
+                              + Sga[2][l] * funder[ (b+8)*W + l ] ) ;
+        for (int d=0; d<3; d++){ KTe[ ( (3*a+d) + 12*(3*b+d) )*W + l ] += gSg ; }
+      }
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+typedef void (*tetraSVKBatchFun)( const double *, const double *, const double *, \
+  double, double, int, int, double *, double * ) ;
+
+static void tetraSVKBatchBaseline( const double * funder, const double * vol, \
+    const double * elemDisps, double young, double nu, int paramOut, \
+    int consMatFlag, double * Finte, double * KTe ){
+  tetraSVKBatchBody( funder, vol, elemDisps, young, nu, paramOut, consMatFlag, Finte, KTe ) ;
+}
+
+#ifdef ONSASPP_X86_DISPATCH
+__attribute__((target("avx2,fma"))) static void tetraSVKBatchAVX2( \
+    const double * funder, const double * vol, const double * elemDisps, \
+    double young, double nu, int paramOut, int consMatFlag, \
+    double * Finte, double * KTe ){
+  tetraSVKBatchBody( funder, vol, elemDisps, young, nu, paramOut, consMatFlag, Finte, KTe ) ;
+}
+
+__attribute__((target("avx512f,avx512dq"))) static void tetraSVKBatchAVX512( \
+    const double * funder, const double * vol, const double * elemDisps, \
+    double young, double nu, int paramOut, int consMatFlag, \
+    double * Finte, double * KTe ){
+  tetraSVKBatchBody( funder, vol, elemDisps, young, nu, paramOut, consMatFlag, Finte, KTe ) ;
+}
+#endif
+
+
+
+
+// =============================================================================
+//  tetraSVKBatchISA
+// =============================================================================
+// instruction set of the batched kernel version used on this CPU
+const char * tetraSVKBatchISA(){
+#ifdef ONSASPP_X86_DISPATCH
+  __builtin_cpu_init() ;
+  if ( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") ){ return "avx512" ; }
+  if ( __builtin_cpu_supports("avx2")    && __builtin_cpu_supports("fma")      ){ return "avx2"   ; }
+#endif
+  return "baseline" ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+//  elementTetraSVKBatch
+// =============================================================================
+// internal forces (12 x W) and, if paramOut == 2, tangent matrices (144 x W,
+// each one by columns) of tetraBatchWidth SVK tetrahedra with the same
+// material. Inputs: funder (12 x W, see computeElemGeometry), volumes (W) and
+// displacements (12 x W), all in structure of arrays form.
+void elementTetraSVKBatch( const double * funder, const double * vol, \
+    const double * elemDisps, double young, double nu, int paramOut, \
+    int consMatFlag, double * Finte, double * KTe ){
+
+  static const tetraSVKBatchFun fun = [](){
+    string isa = tetraSVKBatchISA() ;
+#ifdef ONSASPP_X86_DISPATCH
+    if ( isa == "avx512" ){ return (tetraSVKBatchFun) tetraSVKBatchAVX512 ; }
+    if ( isa == "avx2"   ){ return (tetraSVKBatchFun) tetraSVKBatchAVX2   ; }
+#endif
+    return (tetraSVKBatchFun) tetraSVKBatchBaseline ;
+  }() ;
+
+  fun( funder, vol, elemDisps, young, nu, paramOut, consMatFlag, Finte, KTe ) ;
+}
+// =============================================================================
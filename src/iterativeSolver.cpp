@@ -0,0 +1,753 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- sparseTransposeProduct ---
+// =============================================================================
+// y = M' x: entry i of y is the product of column i of M (CSC) and x. For the
+// symmetric system matrices it is the product M x.
+void sparseTransposeProduct( const sp_mat & M, const double * x, double * y ){
+
+  const uword  * cp = M.col_ptrs ;  const uword * ri = M.row_indices ;
+  const double * v  = M.values   ;
+
+  #pragma omp parallel for schedule(static)
+  for ( int i=0; i < int( M.n_cols ); i++){
+    double s = 0 ;
+    for ( uword p=cp[i]; p < cp[i+1]; p++){ s += v[p] * x[ ri[p] ] ; }
+    y[i] = s ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sparseProductAdd ---
+// =============================================================================
+// y += M x, scattering the columns of M (CSC)
+void sparseProductAdd( const sp_mat & M, const double * x, double * y ){
+
+  for ( uword j=0; j < M.n_cols; j++){
+    for ( uword p=M.col_ptrs[j]; p < M.col_ptrs[j+1]; p++){
+      y[ M.row_indices[p] ] += M.values[p] * x[j] ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sparseTranspose ---
+// =============================================================================
+void sparseTranspose( const sp_mat & M, sp_mat & Mt ){
+
+  uvec colPtrs( M.n_rows+1, fill::zeros ), rowInds( M.n_nonzero ) ;
+  vec  vals( M.n_nonzero ) ;
+
+  for ( uword p=0; p < M.n_nonzero; p++){ colPtrs( M.row_indices[p]+1 )++ ; }
+  for ( uword i=0; i < M.n_rows; i++){ colPtrs( i+1 ) += colPtrs( i ) ; }
+
+  uvec next = colPtrs.head( M.n_rows ) ;
+  for ( uword col=0; col < M.n_cols; col++){
+    for ( uword p=M.col_ptrs[col]; p < M.col_ptrs[col+1]; p++){
+      uword q = next( M.row_indices[p] )++ ;
+      rowInds( q ) = col ;  vals( q ) = M.values[p] ;
+    }
+  }
+  Mt = sp_mat( rowInds, colPtrs, vals, M.n_cols, M.n_rows ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sparseProduct ---
+// =============================================================================
+// C = A B, column by column: column j of C is the combination of the columns
+// of A given by column j of B
+void sparseProduct( const sp_mat & A, const sp_mat & B, sp_mat & C ){
+
+  uword nRows = A.n_rows, nCols = B.n_cols ;
+  vector<uword>  colPtrs( nCols+1, 0 ), rowInds ;
+  vector<double> vals ;
+  vector<uword>  marker( nRows, nCols ) ;
+  vec acc( nRows ) ;
+
+  for ( uword j=0; j < nCols; j++){
+    uword start = rowInds.size() ;
+    for ( uword p=B.col_ptrs[j]; p < B.col_ptrs[j+1]; p++){
+      uword k = B.row_indices[p] ;  double bkj = B.values[p] ;
+      for ( uword q=A.col_ptrs[k]; q < A.col_ptrs[k+1]; q++){
+        uword i = A.row_indices[q] ;
+        if ( marker[i] != j ){
+          marker[i] = j ;  rowInds.push_back( i ) ;  acc( i ) = A.values[q] * bkj ;
+        }else{
+          acc( i ) += A.values[q] * bkj ;
+        }
+      }
+    }
+    std::sort( rowInds.begin() + start, rowInds.end() ) ;
+    for ( uword q=start; q < rowInds.size(); q++){ vals.push_back( acc( rowInds[q] ) ) ; }
+    colPtrs[j+1] = rowInds.size() ;
+  }
+
+  C = sp_mat( conv_to<uvec>::from( rowInds ), conv_to<uvec>::from( colPtrs ), \
+              vec( vals ), nRows, nCols ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- aggregateBlocks ---
+// =============================================================================
+// aggregates of the blocks of dofs of a level (contiguous dofs blockPtrs(b)
+// ... blockPtrs(b+1)-1), from the strong connections of the blocks of A:
+// |A_IJ|^2 > theta^2 |A_II| |A_JJ| (Frobenius norms). Blocks without strong
+// aggregated neighbours start an aggregate with their strong neighbours, the
+// rest join an aggregate of a strong neighbour or start a new one.
+void aggregateBlocks( const sp_mat & A, const uvec & blockPtrs, double theta, \
+  uvec & aggregates, uword & nAggregates ){
+
+  uword nBlocks = blockPtrs.n_elem - 1 ;
+  uvec blockOf( A.n_rows ) ;
+  for ( uword b=0; b < nBlocks; b++){
+    for ( uword i=blockPtrs( b ); i < blockPtrs( b+1 ); i++){ blockOf( i ) = b ; }
+  }
+
+  // squared norms of the blocks of each block column
+  vector< vector<uword> >  neighbours( nBlocks ) ;
+  vector< vector<double> > norms2( nBlocks ) ;
+  vec diagNorms2( nBlocks, fill::zeros ) ;
+  vector<uword> marker( nBlocks, nBlocks ) ;
+  vec acc( nBlocks ) ;
+  for ( uword J=0; J < nBlocks; J++){
+    for ( uword col=blockPtrs( J ); col < blockPtrs( J+1 ); col++){
+      for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+        uword I = blockOf( A.row_indices[p] ) ;  double a2 = A.values[p] * A.values[p] ;
+        if ( I == J ){ diagNorms2( J ) += a2 ;  continue ; }
+        if ( marker[I] != J ){ marker[I] = J ;  neighbours[J].push_back( I ) ;  acc( I ) = 0 ; }
+        acc( I ) += a2 ;
+      }
+    }
+    for ( uword I : neighbours[J] ){ norms2[J].push_back( acc( I ) ) ; }
+  }
+
+  vector< vector<uword> > strong( nBlocks ) ;
+  for ( uword J=0; J < nBlocks; J++){
+    for ( uword k=0; k < neighbours[J].size(); k++){
+      uword I = neighbours[J][k] ;
+      if ( norms2[J][k] > theta * theta * sqrt( diagNorms2( I ) * diagNorms2( J ) ) ){
+        strong[J].push_back( I ) ;
+      }
+    }
+  }
+
+  const uword none = nBlocks ;
+  aggregates.set_size( nBlocks ) ;  aggregates.fill( none ) ;
+  nAggregates = 0 ;
+
+  // 1: blocks with all their strong neighbours free
+  for ( uword b=0; b < nBlocks; b++){
+    if ( aggregates( b ) != none || strong[b].empty() ){ continue ; }
+    bool free = true ;
+    for ( uword n : strong[b] ){ if ( aggregates( n ) != none ){ free = false ;  break ; } }
+    if ( !free ){ continue ; }
+    aggregates( b ) = nAggregates ;
+    for ( uword n : strong[b] ){ aggregates( n ) = nAggregates ; }
+    nAggregates++ ;
+  }
+
+  // 2: to the aggregate of a strong neighbour aggregated in 1
+  uvec firstPass = aggregates ;
+  for ( uword b=0; b < nBlocks; b++){
+    if ( aggregates( b ) != none ){ continue ; }
+    for ( uword n : strong[b] ){
+      if ( firstPass( n ) != none ){ aggregates( b ) = firstPass( n ) ;  break ; }
+    }
+  }
+
+  // 3: new aggregates with the free strong neighbours
+  for ( uword b=0; b < nBlocks; b++){
+    if ( aggregates( b ) != none ){ continue ; }
+    aggregates( b ) = nAggregates ;
+    for ( uword n : strong[b] ){
+      if ( aggregates( n ) == none ){ aggregates( n ) = nAggregates ; }
+    }
+    nAggregates++ ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- tentativeProlongator ---
+// =============================================================================
+// prolongator of the aggregates with the near null space B of the level
+// interpolated exactly: in the rows of each aggregate, B = Q R with the
+// orthonormal columns Q (Gram-Schmidt, dependent columns dropped) the columns
+// of the prolongator, and R the rows of the coarse near null space. The
+// coarse dofs of each aggregate are a block of the coarse level.
+void tentativeProlongator( const uvec & blockPtrs, const uvec & aggregates, \
+  uword nAggregates, const mat & B, sp_mat & Pt, uvec & coarseBlockPtrs, \
+  mat & coarseB ){
+
+  uword nBlocks = blockPtrs.n_elem - 1, nNull = B.n_cols ;
+
+  // dofs of each aggregate, increasing
+  vector< vector<uword> > aggDofs( nAggregates ) ;
+  for ( uword b=0; b < nBlocks; b++){
+    for ( uword i=blockPtrs( b ); i < blockPtrs( b+1 ); i++){
+      aggDofs[ aggregates( b ) ].push_back( i ) ;
+    }
+  }
+
+  vector<uword>  colPtrs( 1, 0 ), rowInds ;
+  vector<double> vals ;
+  vector<uword>  blockPtrsVec( 1, 0 ) ;
+  vector<double> coarseRows ; // rows of coarseB, nNull values each
+
+  for ( uword a=0; a < nAggregates; a++){
+    vector<uword> & dofs = aggDofs[a] ;
+    std::sort( dofs.begin(), dofs.end() ) ;
+    uword m = dofs.size() ;
+
+    mat Bagg( m, nNull ) ;
+    for ( uword r=0; r < m; r++){ Bagg.row( r ) = B.row( dofs[r] ) ; }
+
+    mat Q( m, nNull ), R( nNull, nNull, fill::zeros ) ;
+    uword nCols = 0 ;
+    for ( uword j=0; j < nNull; j++){
+      vec v = Bagg.col( j ) ;
+      double norm0 = norm( v ) ;
+      for ( int pass=0; pass < 2; pass++){
+        for ( uword k=0; k < nCols; k++){
+          double r = dot( Q.col( k ), v ) ;
+          R( k, j ) += r ;  v -= r * Q.col( k ) ;
+        }
+      }
+      double normv = norm( v ) ;
+      if ( normv > 1e-10 * norm0 && normv > 0 ){
+        Q.col( nCols ) = v / normv ;  R( nCols, j ) = normv ;  nCols++ ;
+      }
+    }
+
+    for ( uword k=0; k < nCols; k++){
+      for ( uword r=0; r < m; r++){ rowInds.push_back( dofs[r] ) ;  vals.push_back( Q( r, k ) ) ; }
+      colPtrs.push_back( rowInds.size() ) ;
+      for ( uword j=0; j < nNull; j++){ coarseRows.push_back( R( k, j ) ) ; }
+    }
+    blockPtrsVec.push_back( blockPtrsVec.back() + nCols ) ;
+  }
+
+  uword nCoarse = colPtrs.size() - 1 ;
+  Pt = sp_mat( conv_to<uvec>::from( rowInds ), conv_to<uvec>::from( colPtrs ), \
+               vec( vals ), B.n_rows, nCoarse ) ;
+  coarseBlockPtrs = conv_to<uvec>::from( blockPtrsVec ) ;
+  coarseB.set_size( nCoarse, nNull ) ;
+  for ( uword i=0; i < nCoarse; i++){
+    for ( uword j=0; j < nNull; j++){ coarseB( i, j ) = coarseRows[ i*nNull + j ] ; }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- smoothedProlongator ---
+// =============================================================================
+// P = ( I - omega D^-1 A ) Pt, with the largest eigenvalue of D^-1 A, lambda,
+// estimated by power iterations and omega = 4 / ( 3 lambda )
+void smoothedProlongator( const sp_mat & A, const vec & diagInv, \
+  const sp_mat & Pt, sp_mat & P ){
+
+  uword n = A.n_rows ;
+  vec v( n ), Av( n ) ;
+  for ( uword i=0; i < n; i++){ v( i ) = 1.0 + 0.5 * sin( 1.0 + i ) ; }
+  double lambda = 0 ;
+  for ( int it=0; it < 15; it++){
+    v /= norm( v ) ;
+    sparseTransposeProduct( A, v.memptr(), Av.memptr() ) ;
+    v = diagInv % Av ;
+    lambda = norm( v ) ;
+    if ( lambda == 0 ){ break ; }
+  }
+  double omega = ( lambda > 0 ) ? 4.0 / ( 3.0 * lambda ) : 0 ;
+
+  sp_mat APt ;
+  sparseProduct( A, Pt, APt ) ;
+
+  // merge of the sorted columns of Pt and - omega D^-1 A Pt
+  vector<uword>  colPtrs( Pt.n_cols+1, 0 ), rowInds ;
+  vector<double> vals ;
+  for ( uword j=0; j < Pt.n_cols; j++){
+    uword p = Pt.col_ptrs[j], q = APt.col_ptrs[j] ;
+    while ( p < Pt.col_ptrs[j+1] || q < APt.col_ptrs[j+1] ){
+      uword ip = ( p < Pt .col_ptrs[j+1] ) ? Pt .row_indices[p] : n ;
+      uword iq = ( q < APt.col_ptrs[j+1] ) ? APt.row_indices[q] : n ;
+      uword i  = min( ip, iq ) ;
+      double val = 0 ;
+      if ( ip == i ){ val += Pt.values[p] ;  p++ ; }
+      if ( iq == i ){ val -= omega * diagInv( i ) * APt.values[q] ;  q++ ; }
+      rowInds.push_back( i ) ;  vals.push_back( val ) ;
+    }
+    colPtrs[j+1] = rowInds.size() ;
+  }
+  P = sp_mat( conv_to<uvec>::from( rowInds ), conv_to<uvec>::from( colPtrs ), \
+              vec( vals ), n, Pt.n_cols ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- amgSetup ---
+// =============================================================================
+// smoothed aggregation hierarchy of A, with level 0 the matrix A itself. The
+// aggregates and tentative prolongators are computed with the first matrix
+// and kept; for the next matrices only the smoothed prolongators and the
+// coarse matrices ( P' A P ) are recomputed. The transposes of P are only
+// used by the products. The coarsest matrix is inverted.
+void amgSetup( const sp_mat & A, linearSolverData & solver ){
+
+  const uword  maxLevels = 10, coarseSize = 200 ;
+  const double theta0    = 0.08 ;
+
+  bool build = solver.amgTentP.empty() ;
+  uvec blockPtrs = solver.blockPtrs ;
+  mat  B         = solver.nullSpace ;
+
+  solver.amgP.clear() ;  solver.amgA.clear() ;
+  solver.amgDiagInv.clear() ;
+
+  for ( uword l=0; ; l++){
+    const sp_mat & Al = ( l == 0 ) ? A : solver.amgA.back() ;
+
+    if ( build && ( l+1 >= maxLevels || Al.n_rows <= coarseSize ) ){ break ; }
+    if ( !build && l == solver.amgTentP.size() ){ break ; }
+
+    vec diagInv( Al.n_rows ) ;
+    for ( uword i=0; i < Al.n_rows; i++){
+      double d = Al( i, i ) ;
+      diagInv( i ) = ( d != 0 ) ? 1.0 / d : 0 ;
+    }
+
+    if ( build ){
+      uvec aggregates ;  uword nAggregates ;
+      aggregateBlocks( Al, blockPtrs, theta0 * pow( 0.5, l ), aggregates, nAggregates ) ;
+
+      sp_mat Pt ;  uvec coarseBlockPtrs ;  mat coarseB ;
+      tentativeProlongator( blockPtrs, aggregates, nAggregates, B, Pt, \
+        coarseBlockPtrs, coarseB ) ;
+      if ( Pt.n_cols > 0.75 * Al.n_rows ){ break ; } // slow coarsening
+      solver.amgTentP.push_back( Pt ) ;
+      blockPtrs = coarseBlockPtrs ;  B = coarseB ;
+    }
+
+    sp_mat P, R, AP, Ac ;
+    smoothedProlongator( Al, diagInv, solver.amgTentP[l], P ) ;
+    sparseTranspose( P, R ) ;
+    sparseProduct( Al, P, AP ) ;
+    sparseProduct( R, AP, Ac ) ;
+
+    solver.amgDiagInv.push_back( diagInv ) ;
+    solver.amgP.push_back( P ) ;
+    solver.amgA.push_back( Ac ) ;
+  }
+
+  uword nLevels = solver.amgP.size() ;
+  const sp_mat & Ac = ( nLevels == 0 ) ? A : solver.amgA.back() ;
+  mat dense( Ac.n_rows, Ac.n_cols, fill::zeros ) ;
+  for ( uword col=0; col < Ac.n_cols; col++){
+    for ( uword p=Ac.col_ptrs[col]; p < Ac.col_ptrs[col+1]; p++){
+      dense( Ac.row_indices[p], col ) = Ac.values[p] ;
+    }
+  }
+  if ( !inv( solver.amgCoarseInv, dense ) ){ solver.amgCoarseInv = pinv( dense ) ; }
+
+  solver.amgX.resize( nLevels+1 ) ;  solver.amgB.resize( nLevels+1 ) ;
+  solver.amgRes.resize( nLevels+1 ) ;
+  for ( uword l=0; l <= nLevels; l++){
+    uword nl = ( l == 0 ) ? A.n_rows : solver.amgA[l-1].n_rows ;
+    solver.amgX[l].set_size( nl ) ;  solver.amgB[l].set_size( nl ) ;
+    solver.amgRes[l].set_size( nl ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- amgCycle ---
+// =============================================================================
+// V-cycle from level l, for the right hand side amgB[l] into amgX[l]: forward
+// Gauss-Seidel before and backward after the coarse correction, so that the
+// preconditioner is symmetric. The rows of the symmetric matrices are read
+// from their columns.
+void amgCycle( const sp_mat & A, uword l, linearSolverData & solver ){
+
+  vec & x = solver.amgX[l] ;  const vec & b = solver.amgB[l] ;
+
+  if ( l == solver.amgP.size() ){ x = solver.amgCoarseInv * b ;  return ; }
+
+  const sp_mat & Al = ( l == 0 ) ? A : solver.amgA[l-1] ;
+  const vec & diagInv = solver.amgDiagInv[l] ;
+  const uword * cp = Al.col_ptrs ;  const uword * ri = Al.row_indices ;
+  const double * v = Al.values ;
+  uword n = Al.n_rows ;
+
+  x.zeros() ;
+  for ( uword i=0; i < n; i++){
+    double s = b( i ) ;
+    for ( uword p=cp[i]; p < cp[i+1]; p++){ if ( ri[p] != i ){ s -= v[p] * x( ri[p] ) ; } }
+    x( i ) = s * diagInv( i ) ;
+  }
+
+  vec & res = solver.amgRes[l] ;
+  sparseTransposeProduct( Al, x.memptr(), res.memptr() ) ;
+  res = b - res ;
+  sparseTransposeProduct( solver.amgP[l], res.memptr(), solver.amgB[l+1].memptr() ) ;
+
+  amgCycle( A, l+1, solver ) ;
+
+  sparseProductAdd( solver.amgP[l], solver.amgX[l+1].memptr(), x.memptr() ) ;
+
+  for ( uword i=n; i-- > 0; ){
+    double s = b( i ) ;
+    for ( uword p=cp[i]; p < cp[i+1]; p++){ if ( ri[p] != i ){ s -= v[p] * x( ri[p] ) ; } }
+    x( i ) = s * diagInv( i ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- blockInversesLayout ---
+// =============================================================================
+// positions of the node blocks in blockInvs, m*m values for a block of m dofs
+void blockInversesLayout( linearSolverData & solver ){
+
+  uword nBlocks = solver.blockPtrs.n_elem - 1 ;
+  solver.blockInvPtrs.set_size( nBlocks+1 ) ;
+  solver.blockInvPtrs( 0 ) = 0 ;
+  for ( uword b=0; b < nBlocks; b++){
+    uword m = solver.blockPtrs( b+1 ) - solver.blockPtrs( b ) ;
+    solver.blockInvPtrs( b+1 ) = solver.blockInvPtrs( b ) + m*m ;
+  }
+  solver.blockInvs.set_size( solver.blockInvPtrs( nBlocks ) ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- invertBlocks ---
+// =============================================================================
+// replaces the node blocks stored in blockInvs by their inverses
+void invertBlocks( linearSolverData & solver ){
+
+  uword nBlocks = solver.blockPtrs.n_elem - 1 ;
+  for ( uword b=0; b < nBlocks; b++){
+    uword m = solver.blockPtrs( b+1 ) - solver.blockPtrs( b ) ;
+    double * values = solver.blockInvs.memptr() + solver.blockInvPtrs( b ) ;
+    mat block( values, m, m ), blockInv ;
+    if ( !inv( blockInv, block ) ){ blockInv = pinv( block ) ; }
+    std::copy( blockInv.memptr(), blockInv.memptr() + m*m, values ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- preconditionerSetup ---
+// =============================================================================
+// numeric setup of the preconditioner for the matrix A: inverses of the
+// diagonal blocks of the nodes (1) or smoothed aggregation hierarchy (2)
+void preconditionerSetup( const sp_mat & A, linearSolverData & solver ){
+
+  if ( solver.preconditioner == 1 ){
+    uword nBlocks = solver.blockPtrs.n_elem - 1 ;
+    blockInversesLayout( solver ) ;
+    solver.blockInvs.zeros() ;
+
+    for ( uword b=0; b < nBlocks; b++){
+      uword first = solver.blockPtrs( b ), m = solver.blockPtrs( b+1 ) - first ;
+      double * block = solver.blockInvs.memptr() + solver.blockInvPtrs( b ) ;
+      for ( uword c=0; c < m; c++){
+        for ( uword p=A.col_ptrs[first+c]; p < A.col_ptrs[first+c+1]; p++){
+          uword row = A.row_indices[p] ;
+          if ( row >= first && row < first+m ){ block[ row-first + m*c ] = A.values[p] ; }
+        }
+      }
+    }
+    invertBlocks( solver ) ;
+  }else if ( solver.preconditioner == 2 ){
+    amgSetup( A, solver ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- applyBlockJacobi ---
+// =============================================================================
+// z = inverses of the node blocks times r
+void applyBlockJacobi( const linearSolverData & solver, const double * r, double * z ){
+
+  uword nBlocks = solver.blockPtrs.n_elem - 1 ;
+  #pragma omp parallel for schedule(static)
+  for ( int b=0; b < int( nBlocks ); b++){
+    uword first = solver.blockPtrs( b ), m = solver.blockPtrs( b+1 ) - first ;
+    const double * blockInv = solver.blockInvs.memptr() + solver.blockInvPtrs( b ) ;
+    for ( uword i=0; i < m; i++){
+      double s = 0 ;
+      for ( uword j=0; j < m; j++){ s += blockInv[ i + m*j ] * r[ first+j ] ; }
+      z[ first+i ] = s ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- applyPreconditioner ---
+// =============================================================================
+void applyPreconditioner( const sp_mat & A, linearSolverData & solver, \
+  const double * r, double * z ){
+
+  uword n = A.n_rows ;
+  if ( solver.preconditioner == 1 ){
+    applyBlockJacobi( solver, r, z ) ;
+  }else if ( solver.preconditioner == 2 ){
+    std::copy( r, r+n, solver.amgB[0].memptr() ) ;
+    amgCycle( A, 0, solver ) ;
+    std::copy( solver.amgX[0].memptr(), solver.amgX[0].memptr() + n, z ) ;
+  }else{
+    std::copy( r, r+n, z ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- conjugateGradient ---
+// =============================================================================
+// preconditioned conjugate gradients from x = 0, until |b - A x| <= relTol |b|,
+// with the products of the matrix and of the preconditioner given by applyA
+// and applyM
+void conjugateGradient( const linearOperator & applyA, const linearOperator & applyM, \
+  const vec & b, double relTol, linearSolverData & solver, vec & x ){
+
+  uword n = b.n_elem ;
+  mat & work = solver.krylovWork ;
+  if ( work.n_rows != n || work.n_cols < 4 ){ work.set_size( n, 7 ) ; }
+  double * r = work.colptr( 0 ) ;  double * z  = work.colptr( 1 ) ;
+  double * p = work.colptr( 2 ) ;  double * Ap = work.colptr( 3 ) ;
+
+  x.zeros( n ) ;
+  std::copy( b.memptr(), b.memptr()+n, r ) ;
+  double normB = norm( b ), normR = normB ;
+  solver.lastIters = 0 ;
+
+  if ( normB > 0 ){
+    applyM( r, z ) ;
+    std::copy( z, z+n, p ) ;
+    double rz = 0 ;
+    for ( uword i=0; i < n; i++){ rz += r[i] * z[i] ; }
+
+    while ( solver.lastIters < solver.maxIts && normR > relTol * normB ){
+      applyA( p, Ap ) ;
+      double pAp = 0 ;
+      for ( uword i=0; i < n; i++){ pAp += p[i] * Ap[i] ; }
+      if ( pAp <= 0 ){ break ; } // not positive definite
+      solver.lastIters++ ;
+
+      double alpha = rz / pAp ;  normR = 0 ;
+      for ( uword i=0; i < n; i++){
+        x( i ) += alpha * p[i] ;  r[i] -= alpha * Ap[i] ;  normR += r[i] * r[i] ;
+      }
+      normR = sqrt( normR ) ;
+
+      applyM( r, z ) ;
+      double rzNew = 0 ;
+      for ( uword i=0; i < n; i++){ rzNew += r[i] * z[i] ; }
+      double beta = rzNew / rz ;  rz = rzNew ;
+      for ( uword i=0; i < n; i++){ p[i] = z[i] + beta * p[i] ; }
+    }
+  }
+  solver.lastRelRes = ( normB > 0 ) ? normR / normB : 0 ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- minimalResidual ---
+// =============================================================================
+// preconditioned MINRES (Paige and Saunders) from x = 0, for symmetric
+// matrices also when they are indefinite, with a symmetric positive definite
+// preconditioner. Stops when the preconditioned residual norm is reduced by
+// relTol. The products are given as in conjugateGradient.
+void minimalResidual( const linearOperator & applyA, const linearOperator & applyM, \
+  const vec & b, double relTol, linearSolverData & solver, vec & x ){
+
+  uword n = b.n_elem ;
+  mat & work = solver.krylovWork ;
+  if ( work.n_rows != n || work.n_cols < 7 ){ work.set_size( n, 7 ) ; }
+  double * r1 = work.colptr( 0 ) ;  double * r2 = work.colptr( 1 ) ;
+  double * y  = work.colptr( 2 ) ;  double * v  = work.colptr( 3 ) ;
+  double * w  = work.colptr( 4 ) ;  double * w1 = work.colptr( 5 ) ;
+  double * w2 = work.colptr( 6 ) ;
+
+  x.zeros( n ) ;
+  solver.lastIters = 0 ;  solver.lastRelRes = 0 ;
+
+  std::copy( b.memptr(), b.memptr()+n, r1 ) ;
+  std::copy( b.memptr(), b.memptr()+n, r2 ) ;
+  applyM( r1, y ) ;
+  double beta1 = 0 ;
+  for ( uword i=0; i < n; i++){ beta1 += r1[i] * y[i] ; }
+  if ( beta1 <= 0 ){ return ; }
+  beta1 = sqrt( beta1 ) ;
+
+  std::fill( w, w+n, 0.0 ) ;  std::fill( w2, w2+n, 0.0 ) ;
+  double oldb = 0, beta = beta1, dbar = 0, epsln = 0, phibar = beta1 ;
+  double cs = -1, sn = 0 ;
+
+  while ( solver.lastIters < solver.maxIts && phibar > relTol * beta1 ){
+
+    // Lanczos step
+    for ( uword i=0; i < n; i++){ v[i] = y[i] / beta ; }
+    applyA( v, y ) ;
+    if ( solver.lastIters >= 1 ){
+      for ( uword i=0; i < n; i++){ y[i] -= ( beta / oldb ) * r1[i] ; }
+    }
+    double alfa = 0 ;
+    for ( uword i=0; i < n; i++){ alfa += v[i] * y[i] ; }
+    for ( uword i=0; i < n; i++){ y[i] -= ( alfa / beta ) * r2[i] ; }
+    std::swap( r1, r2 ) ;
+    std::copy( y, y+n, r2 ) ;
+    applyM( r2, y ) ;
+    oldb = beta ;  beta = 0 ;
+    for ( uword i=0; i < n; i++){ beta += r2[i] * y[i] ; }
+    if ( beta < 0 ){ break ; } // preconditioner not positive definite
+    beta = sqrt( beta ) ;
+
+    // plane rotation and update of the solution
+    double oldeps = epsln ;
+    double delta  = cs * dbar + sn * alfa ;
+    double gbar   = sn * dbar - cs * alfa ;
+    epsln = sn * beta ;
+    dbar  = - cs * beta ;
+    double gamma = max( hypot( gbar, beta ), 1e-300 ) ;
+    cs = gbar / gamma ;  sn = beta / gamma ;
+    double phi = cs * phibar ;
+    phibar = sn * phibar ;
+
+    std::swap( w1, w2 ) ;  std::swap( w2, w ) ;
+    for ( uword i=0; i < n; i++){
+      w[i] = ( v[i] - oldeps * w1[i] - delta * w2[i] ) / gamma ;
+      x( i ) += phi * w[i] ;
+    }
+    solver.lastIters++ ;
+    if ( beta == 0 ){ phibar = 0 ;  break ; }
+  }
+  solver.lastRelRes = phibar / beta1 ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- iterativeSolverSolve ---
+// =============================================================================
+// solves A x = b with conjugate gradients (method 2) or MINRES (method 3),
+// up to the relative tolerance relTol. The preconditioner is computed again
+// only when matrixVersion is not the version of the last matrix. Returns
+// false when the solution is not within the tolerance, see
+// iterativeSolverConverged.
+bool iterativeSolverSolve( const sp_mat & A, unsigned int matrixVersion, \
+  const vec & b, double relTol, linearSolverData & solver, vec & x ){
+
+  if ( !solver.factorized || solver.factorizedVersion != matrixVersion ){
+    preconditionerSetup( A, solver ) ;
+    solver.factorized = true ;  solver.factorizedVersion = matrixVersion ;
+    solver.nFactorizations++ ;
+  }
+
+  linearOperator applyA = [&]( const double * v, double * Av ){
+    sparseTransposeProduct( A, v, Av ) ;
+  } ;
+  linearOperator applyM = [&]( const double * r, double * z ){
+    applyPreconditioner( A, solver, r, z ) ;
+  } ;
+
+  if ( solver.method == 3 ){
+    minimalResidual( applyA, applyM, b, relTol, solver, x ) ;
+  }else{
+    conjugateGradient( applyA, applyM, b, relTol, solver, x ) ;
+  }
+  return iterativeSolverConverged( b, relTol, solver ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- iterativeSolverConverged ---
+// =============================================================================
+// whether the last solve of b by conjugateGradient or minimalResidual reached
+// the relative tolerance relTol, up to a factor iterativeSolverTolFactor for
+// the round-off and the MINRES estimate of the residual (at most sqrt(relTol),
+// for the loose forcing terms): false when the method stopped at maxIts or
+// on a matrix that is not positive definite (conjugate gradients)
+bool iterativeSolverConverged( const vec & b, double relTol, \
+  const linearSolverData & solver ){
+  if ( norm( b ) == 0 ){ return true ; }
+  return solver.lastRelRes <= min( iterativeSolverTolFactor * relTol, sqrt( relTol ) ) ;
+}
+// =============================================================================
@@ -0,0 +1,573 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+#include <set>
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- minimumDegreeOrdering ---
+// =============================================================================
+// fill reducing ordering of the dofs of a symmetric pattern (CSC, 0-based,
+// all the entries or only one triangle). The dofs of the same block (the
+// free dofs of a node) have the same adjacency, so the minimum degree
+// elimination is done on the graph of the blocks, with the degrees counted
+// in dofs, and the dofs of each block are numbered consecutively.
+// The elimination graph is kept as a quotient graph, as in the approximate
+// minimum degree ordering (AMD): an eliminated block becomes an element,
+// the list of its neighbours, instead of making them a clique. A block is
+// adjacent to blocks and elements, the elements of the eliminated block are
+// absorbed by the new one, and so are the ones whose neighbours are all in
+// it. The degrees of the neighbours of the eliminated block are updated
+// with the AMD upper bound, from the sizes of their elements outside the
+// new one. Blocks with the same adjacency are not merged.
+void minimumDegreeOrdering( const uvec & colPtrs, const uvec & rowInds, \
+  const uvec & dofBlocks, uvec & perm ){
+
+  uword nDofs = colPtrs.n_elem - 1 ;
+
+  // blocks numbered 0 ... nBlocks-1 in order of first appearance
+  uvec blockId( nDofs ) ;
+  vector<uword> blockWeight ;
+  {
+    uword maxBlock = 0 ;
+    for ( uword i=0; i < nDofs; i++){ maxBlock = max( maxBlock, dofBlocks( i ) ) ; }
+    vector<uword> ids( maxBlock+1, nDofs ) ;
+    for ( uword i=0; i < nDofs; i++){
+      if ( ids[ dofBlocks( i ) ] == nDofs ){
+        ids[ dofBlocks( i ) ] = blockWeight.size() ;
+        blockWeight.push_back( 0 ) ;
+      }
+      blockId( i ) = ids[ dofBlocks( i ) ] ;
+      blockWeight[ blockId( i ) ]++ ;
+    }
+  }
+  uword nBlocks = blockWeight.size() ;
+
+  // adjacency lists of the blocks graph: adjacent blocks of the not
+  // eliminated blocks, and elements, by the number of the eliminated block
+  vector< vector<uword> > adj( nBlocks ), elems( nBlocks ), elemBlocks( nBlocks ) ;
+  for ( uword col=0; col < nDofs; col++){
+    for ( uword k=colPtrs( col ); k < colPtrs( col+1 ); k++){
+      uword a = blockId( col ), b = blockId( rowInds( k ) ) ;
+      if ( a != b ){ adj[a].push_back( b ) ;  adj[b].push_back( a ) ; }
+    }
+  }
+  vector<uword> degree( nBlocks, 0 ) ;
+  set< pair<uword,uword> > queue ;
+  for ( uword b=0; b < nBlocks; b++){
+    std::sort( adj[b].begin(), adj[b].end() ) ;
+    adj[b].erase( std::unique( adj[b].begin(), adj[b].end() ), adj[b].end() ) ;
+    for ( uword a : adj[b] ){ degree[b] += blockWeight[a] ; }
+    queue.insert( make_pair( degree[b], b ) ) ;
+  }
+
+  // absorbed[e]: element e is in a later one. mark[a] == p: a is in the
+  // element p. outside[e]: weight of the blocks of element e that are not in
+  // the new element, nDofs when not computed for the current pivot.
+  vector<bool>  absorbed( nBlocks, false ) ;
+  vector<uword> mark( nBlocks, nBlocks ), outside( nBlocks, nDofs ), elemWeight( nBlocks, 0 ) ;
+  vector<uword> touched ;
+  uword remaining = nDofs ;
+
+  vector<uword> blockOrder ;  blockOrder.reserve( nBlocks ) ;
+  while ( !queue.empty() ){
+    uword p = queue.begin()->second ;
+    queue.erase( queue.begin() ) ;
+    blockOrder.push_back( p ) ;
+    remaining -= blockWeight[p] ;
+
+    // the new element: the adjacent blocks of p and the blocks of its
+    // elements, which are absorbed
+    vector<uword> & newElem = elemBlocks[p] ;
+    mark[p] = p ;
+    for ( uword a : adj[p] ){
+      if ( mark[a] != p ){ mark[a] = p ;  newElem.push_back( a ) ; }
+    }
+    for ( uword e : elems[p] ){
+      for ( uword a : elemBlocks[e] ){
+        if ( mark[a] != p ){ mark[a] = p ;  newElem.push_back( a ) ; }
+      }
+      absorbed[e] = true ;
+      vector<uword>().swap( elemBlocks[e] ) ;
+    }
+    vector<uword>().swap( adj[p] ) ;
+    vector<uword>().swap( elems[p] ) ;
+    uword newWeight = 0 ;
+    for ( uword a : newElem ){ newWeight += blockWeight[a] ; }
+    elemWeight[p] = newWeight ;
+
+    // weights of the other elements of the blocks of the new one outside it
+    touched.clear() ;
+    for ( uword a : newElem ){
+      for ( uword e : elems[a] ){
+        if ( absorbed[e] ){ continue ; }
+        if ( outside[e] == nDofs ){ outside[e] = elemWeight[e] ;  touched.push_back( e ) ; }
+        outside[e] -= blockWeight[a] ;
+      }
+    }
+
+    // the blocks of the new element: without the absorbed elements and the
+    // adjacent blocks in the new element, which it covers, and with the
+    // approximate degree
+    for ( uword a : newElem ){
+      uword count = 0, elemsDegree = 0 ;
+      for ( uword e : elems[a] ){
+        if ( !absorbed[e] && outside[e] == 0 ){
+          absorbed[e] = true ;  vector<uword>().swap( elemBlocks[e] ) ;
+        }
+        if ( absorbed[e] ){ continue ; }
+        elems[a][ count++ ] = e ;
+        elemsDegree += outside[e] ;
+      }
+      elems[a].resize( count ) ;
+      elems[a].push_back( p ) ;
+
+      uword adjDegree = 0 ;
+      count = 0 ;
+      for ( uword b : adj[a] ){
+        if ( mark[b] == p ){ continue ; }
+        adj[a][ count++ ] = b ;
+        adjDegree += blockWeight[b] ;
+      }
+      adj[a].resize( count ) ;
+
+      uword inNew = newWeight - blockWeight[a] ;
+      uword newDegree = min( { remaining - blockWeight[a], degree[a] + inNew, \
+                               adjDegree + inNew + elemsDegree } ) ;
+      queue.erase( make_pair( degree[a], a ) ) ;
+      degree[a] = newDegree ;
+      queue.insert( make_pair( degree[a], a ) ) ;
+    }
+    for ( uword e : touched ){ outside[e] = nDofs ; }
+  }
+
+  // dofs of each block, in increasing order
+  vector<uword> blockPtrs( nBlocks+1, 0 ), blockDofs( nDofs ) ;
+  for ( uword i=0; i < nDofs; i++){ blockPtrs[ blockId( i )+1 ]++ ; }
+  for ( uword b=0; b < nBlocks; b++){ blockPtrs[b+1] += blockPtrs[b] ; }
+  {
+    vector<uword> next( blockPtrs.begin(), blockPtrs.end()-1 ) ;
+    for ( uword i=0; i < nDofs; i++){ blockDofs[ next[ blockId( i ) ]++ ] = i ; }
+  }
+
+  perm.set_size( nDofs ) ;
+  uword k = 0 ;
+  for ( uword b : blockOrder ){
+    for ( uword p=blockPtrs[b]; p < blockPtrs[b+1]; p++){ perm( k++ ) = blockDofs[p] ; }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// arrays of the numeric factorization of the analysed pattern (solver.Lp)
+static void allocateFactor( linearSolverData & solver ){
+
+  uword n = solver.perm.n_elem ;
+  solver.Lnz    .set_size( n ) ;
+  solver.Li     .set_size( solver.Lp( n ) ) ;
+  solver.Lx     .set_size( solver.Lp( n ) ) ;
+  solver.D      .set_size( n ) ;
+  solver.work   .zeros   ( n ) ;
+  solver.pattern.set_size( n ) ;
+
+  solver.analysed   = true  ;
+  solver.factorized = false ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverAnalysis ---
+// =============================================================================
+// ordering and symbolic LDL' factorization of a symmetric pattern (CSC,
+// 0-based): elimination tree and number of entries of each column of L, for
+// the pattern permuted by solver.perm. Only the entries of the permuted
+// upper triangle are used. With solver.naturalOrder the dofs are not
+// reordered, when the nodes were already numbered for fill (renumberModel).
+void linearSolverAnalysis( const uvec & colPtrs, const uvec & rowInds, \
+  const uvec & dofBlocks, linearSolverData & solver ){
+
+  uword n = colPtrs.n_elem - 1 ;
+
+  solver.dofBlocks = dofBlocks ;
+  if ( solver.dofBlocks.n_elem != n ){ solver.dofBlocks = regspace<uvec>( 0, n-1 ) ; }
+  if ( solver.naturalOrder ){
+    solver.perm = regspace<uvec>( 0, n-1 ) ;
+  }else{
+    minimumDegreeOrdering( colPtrs, rowInds, solver.dofBlocks, solver.perm ) ;
+  }
+
+  solver.permInv.set_size( n ) ;
+  for ( uword k=0; k < n; k++){ solver.permInv( solver.perm( k ) ) = k ; }
+
+  solver.colPtrs = colPtrs ;
+  solver.rowInds = rowInds ;
+
+  solver.parent.set_size( n ) ;
+  solver.flag  .set_size( n ) ;
+  uvec Lnz( n, fill::zeros ) ;
+
+  for ( uword k=0; k < n; k++){
+    solver.parent( k ) = -1 ;
+    solver.flag  ( k ) = k ;
+    uword col = solver.perm( k ) ;
+    for ( uword p=colPtrs( col ); p < colPtrs( col+1 ); p++){
+      uword i = solver.permInv( rowInds( p ) ) ;
+      // path from i to the root of its subtree, up to k
+      for ( ; i < k && solver.flag( i ) != k; i = solver.parent( i ) ){
+        if ( solver.parent( i ) == -1 ){ solver.parent( i ) = k ; }
+        Lnz( i )++ ;
+        solver.flag( i ) = k ;
+      }
+    }
+  }
+
+  solver.Lp.set_size( n+1 ) ;
+  solver.Lp( 0 ) = 0 ;
+  for ( uword k=0; k < n; k++){ solver.Lp( k+1 ) = solver.Lp( k ) + Lnz( k ) ; }
+
+  allocateFactor( solver ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverAnalysisRestore ---
+// =============================================================================
+// analysis of linearSolverAnalysis kept by a checkpoint (see
+// sessionCheckpoint): pattern, blocks of dofs, ordering, elimination tree and
+// column pointers of L
+void linearSolverAnalysisRestore( const uvec & colPtrs, const uvec & rowInds, \
+  const uvec & dofBlocks, const uvec & perm, const ivec & parent, const uvec & Lp, \
+  linearSolverData & solver ){
+
+  uword n = perm.n_elem ;
+  solver.colPtrs   = colPtrs   ;
+  solver.rowInds   = rowInds   ;
+  solver.dofBlocks = dofBlocks ;
+  solver.perm      = perm      ;
+  solver.parent    = parent    ;
+  solver.Lp        = Lp        ;
+
+  solver.permInv.set_size( n ) ;
+  for ( uword k=0; k < n; k++){ solver.permInv( solver.perm( k ) ) = k ; }
+  solver.flag.set_size( n ) ;
+
+  allocateFactor( solver ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverSetup ---
+// =============================================================================
+// data of the free dofs used by the linear solvers: the nodes, ordered
+// together by the LDL' analysis and blocks of the Jacobi preconditioner, and
+// the rigid body modes, near null space of the smoothed aggregation (centred
+// and scaled coordinates). For the LDL' solver, analysis of the pattern of
+// the reduced tangent matrix, unless it was restored (see
+// linearSolverAnalysisRestore).
+void linearSolverSetup( const modelData & model, const assemblyData & assembly, \
+  linearSolverData & solver ){
+
+  uword n = model.redDofs.n_elem ;
+  uvec dofBlocks( n ) ;
+  vector<uword> blockPtrs( 1, 0 ) ;
+  for ( uword i=0; i < n; i++){
+    dofBlocks( i ) = model.redDofs( i ) / model.dofsPerNode ;
+    if ( i > 0 && dofBlocks( i ) != dofBlocks( i-1 ) ){ blockPtrs.push_back( i ) ; }
+  }
+  if ( n > 0 ){ blockPtrs.push_back( n ) ; }
+  solver.blockPtrs = conv_to<uvec>::from( blockPtrs ) ;
+
+  double center[3] = { mean( model.nodeCoordsX ), mean( model.nodeCoordsY ), \
+                       mean( model.nodeCoordsZ ) } ;
+  double scale = max( max( abs( model.nodeCoordsX - center[0] ) ), \
+                 max( max( abs( model.nodeCoordsY - center[1] ) ), \
+                      max( abs( model.nodeCoordsZ - center[2] ) ) ) ) ;
+  if ( scale == 0 ){ scale = 1 ; }
+
+  solver.nullSpace.zeros( n, 6 ) ;
+  for ( uword i=0; i < n; i++){
+    uword node = dofBlocks( i ), local = model.redDofs( i ) % model.dofsPerNode ;
+    uword axis = local / model.transDofStep ;
+    double x[3] = { ( model.nodeCoordsX( node ) - center[0] ) / scale, \
+                    ( model.nodeCoordsY( node ) - center[1] ) / scale, \
+                    ( model.nodeCoordsZ( node ) - center[2] ) / scale } ;
+    if ( local % model.transDofStep != 0 ){
+      solver.nullSpace( i, 3+axis ) = 1 ; // rotation dof
+    }else{
+      // translation and rotations about the axes: ( 0,-z,y ), ( z,0,-x ), ( -y,x,0 )
+      solver.nullSpace( i, axis ) = 1 ;
+      solver.nullSpace( i, 3 + (axis+1)%3 ) =   x[ (axis+2)%3 ] ;
+      solver.nullSpace( i, 3 + (axis+2)%3 ) = - x[ (axis+1)%3 ] ;
+    }
+  }
+
+  // the analysis restored from a checkpoint is kept
+  if ( solver.method == 1 ){
+    if ( !solver.analysed ){
+      linearSolverAnalysis( assembly.colPtrs, assembly.rowInds, dofBlocks, solver ) ;
+    }
+  }else{
+    solver.dofBlocks = dofBlocks ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverFactorize ---
+// =============================================================================
+// numeric LDL' factorization of A (up-looking, row k of L from the rows of
+// the elimination tree reached by column k of A). The pattern of A must be
+// contained in the analysed pattern, otherwise the pattern of A is analysed.
+// Only the entries of the upper triangle of A in the ordering are read, so A
+// may be given in half storage (solver.halfStored, see computeHalfPattern).
+// Returns false when A is not symmetric or a pivot is zero, then the
+// factorization can not be used.
+bool linearSolverFactorize( const sp_mat & A, linearSolverData & solver ){
+
+  uword n = A.n_cols ;
+  const uword  * Ap = A.col_ptrs    ;
+  const uword  * Ai = A.row_indices ;
+  const double * Ax = A.values      ;
+
+  solver.factorized = false ;
+  if ( A.n_rows != n ){ return false ; }
+
+  // pattern contained in the analysed one, both with sorted rows
+  bool contained = solver.analysed && ( solver.colPtrs.n_elem == n+1 ) ;
+  for ( uword col=0; contained && col < n; col++){
+    uword q = solver.colPtrs( col ) ;
+    for ( uword p=Ap[col]; p < Ap[col+1]; p++){
+      while ( q < solver.colPtrs( col+1 ) && solver.rowInds( q ) < Ai[p] ){ q++ ; }
+      if ( q == solver.colPtrs( col+1 ) || solver.rowInds( q ) != Ai[p] ){ contained = false ; break ; }
+    }
+  }
+  // the half storage is tied to the analysed ordering
+  if ( !contained && solver.halfStored ){ return false ; }
+  if ( !contained ){
+    uvec colPtrs( n+1 ), rowInds( A.n_nonzero ) ;
+    for ( uword i=0; i <= n; i++){ colPtrs( i ) = Ap[i] ; }
+    for ( uword p=0; p < A.n_nonzero; p++){ rowInds( p ) = Ai[p] ; }
+    linearSolverAnalysis( colPtrs, rowInds, solver.dofBlocks, solver ) ;
+  }
+
+  // symmetry, up to round-off, from the entries of the upper triangle. A
+  // matrix with half storage is symmetric by construction.
+  double maxAbs = 0 ;
+  for ( uword p=0; p < A.n_nonzero; p++){ maxAbs = max( maxAbs, fabs( Ax[p] ) ) ; }
+  for ( uword col=0; !solver.halfStored && col < n; col++){
+    for ( uword p=Ap[col]; p < Ap[col+1] && Ai[p] < col; p++){
+      uword row = Ai[p] ;
+      const uword * pos = std::lower_bound( Ai + Ap[row], Ai + Ap[row+1], col ) ;
+      double transposed = ( pos != Ai + Ap[row+1] && *pos == col ) ? Ax[ pos - Ai ] : 0 ;
+      if ( fabs( Ax[p] - transposed ) > 1e-10 * maxAbs ){ return false ; }
+    }
+  }
+
+  const uvec & perm = solver.perm ;  const uvec & permInv = solver.permInv ;
+  const ivec & parent = solver.parent ;
+  uvec & flag = solver.flag ;  uvec & pattern = solver.pattern ;
+  uvec & Lnz  = solver.Lnz  ;  vec  & Y       = solver.work    ;
+  const uvec & Lp = solver.Lp ;  uvec & Li = solver.Li ;
+  vec & Lx = solver.Lx ;  vec & D = solver.D ;
+
+  solver.nNegPivots = 0 ;
+  for ( uword k=0; k < n; k++){
+    // nonzero pattern of row k of L, in topological order in pattern(top:n-1)
+    Y( k ) = 0 ;  uword top = n ;
+    flag( k ) = k ;  Lnz( k ) = 0 ;
+    uword col = perm( k ) ;
+    for ( uword p=Ap[col]; p < Ap[col+1]; p++){
+      uword i = permInv( Ai[p] ) ;
+      if ( i > k ){ continue ; }
+      Y( i ) += Ax[p] ;
+      uword len = 0 ;
+      for ( ; flag( i ) != k; i = parent( i ) ){
+        pattern( len++ ) = i ;  flag( i ) = k ;
+      }
+      while ( len > 0 ){ pattern( --top ) = pattern( --len ) ; }
+    }
+
+    // row k of L and pivot D(k)
+    D( k ) = Y( k ) ;  Y( k ) = 0 ;
+    for ( ; top < n; top++){
+      uword i = pattern( top ) ;
+      double yi = Y( i ) ;  Y( i ) = 0 ;
+      uword pEnd = Lp( i ) + Lnz( i ) ;
+      for ( uword p=Lp( i ); p < pEnd; p++){ Y( Li( p ) ) -= Lx( p ) * yi ; }
+      double lki = yi / D( i ) ;
+      D( k ) -= lki * yi ;
+      Li( pEnd ) = k ;  Lx( pEnd ) = lki ;  Lnz( i )++ ;
+    }
+    if ( D( k ) == 0 || !std::isfinite( D( k ) ) ){ return false ; }
+    if ( D( k ) < 0 ){ solver.nNegPivots++ ; }
+  }
+
+  solver.factorized = true ;
+  solver.nFactorizations++ ;
+  return true ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverSolve ---
+// =============================================================================
+// solves A x = b with the LDL' factorization of A. The factorization is
+// recomputed only when matrixVersion is not the version of the factorized
+// matrix. Returns false when A can not be factorized.
+bool linearSolverSolve( const sp_mat & A, unsigned int matrixVersion, \
+  const vec & b, linearSolverData & solver, vec & x ){
+
+  if ( !solver.factorized || solver.factorizedVersion != matrixVersion ){
+    if ( !linearSolverFactorize( A, solver ) ){ return false ; }
+    solver.factorizedVersion = matrixVersion ;
+  }
+
+  uword n = b.n_elem ;
+  const uvec & perm = solver.perm ;  const uvec & Lp = solver.Lp ;
+  const uvec & Lnz  = solver.Lnz  ;  const uvec & Li = solver.Li ;
+  const vec  & Lx   = solver.Lx   ;  const vec  & D  = solver.D  ;
+  vec & y = solver.work ;
+
+  for ( uword k=0; k < n; k++){ y( k ) = b( perm( k ) ) ; }
+  for ( uword j=0; j < n; j++){
+    for ( uword p=Lp( j ); p < Lp( j ) + Lnz( j ); p++){ y( Li( p ) ) -= Lx( p ) * y( j ) ; }
+  }
+  for ( uword j=0; j < n; j++){ y( j ) /= D( j ) ; }
+  for ( uword j=n; j-- > 0; ){
+    for ( uword p=Lp( j ); p < Lp( j ) + Lnz( j ); p++){ y( j ) -= Lx( p ) * y( Li( p ) ) ; }
+  }
+
+  x.set_size( n ) ;
+  for ( uword k=0; k < n; k++){ x( perm( k ) ) = y( k ) ; }
+  y.zeros() ;
+  return true ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- linearSolverBytes ---
+// =============================================================================
+// memory used by the solver data: factors, preconditioners and work vectors
+double linearSolverBytes( const linearSolverData & solver ){
+
+  double bytes = 8.0 * ( solver.dofBlocks.n_elem + solver.perm.n_elem \
+    + solver.permInv.n_elem + solver.colPtrs.n_elem + solver.rowInds.n_elem \
+    + solver.parent.n_elem + solver.Lp.n_elem + solver.Lnz.n_elem + solver.Li.n_elem \
+    + solver.Lx.n_elem + solver.D.n_elem + solver.work.n_elem + solver.flag.n_elem \
+    + solver.pattern.n_elem + solver.blockPtrs.n_elem + solver.nullSpace.n_elem \
+    + solver.blockInvPtrs.n_elem + solver.blockInvs.n_elem \
+    + solver.amgCoarseInv.n_elem + solver.krylovWork.n_elem ) ;
+
+  for ( const vector<sp_mat> * mats : { &solver.amgTentP, &solver.amgP, &solver.amgA } ){
+    for ( const sp_mat & M : *mats ){ bytes += 16.0 * M.n_nonzero + 8.0 * ( M.n_cols + 1 ) ; }
+  }
+  for ( const vector<vec> * vecs : { &solver.amgDiagInv, &solver.amgX, &solver.amgB, &solver.amgRes } ){
+    for ( const vec & v : *vecs ){ bytes += 8.0 * v.n_elem ; }
+  }
+  return bytes ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- fullToHalfStorage ---
+// =============================================================================
+// keeps, in place, the entries ( row, col ) of the symmetric matrix A with
+// permInv(row) <= permInv(col), as computeHalfPattern
+void fullToHalfStorage( const uvec & permInv, sp_mat & A ){
+
+  uword nHalf = 0 ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      if ( permInv( A.row_indices[p] ) <= permInv( col ) ){ nHalf++ ; }
+    }
+  }
+
+  umat locations( 2, nHalf ) ;
+  vec  values( nHalf ) ;
+  uword k = 0 ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      if ( permInv( A.row_indices[p] ) <= permInv( col ) ){
+        locations( 0, k ) = A.row_indices[p] ;  locations( 1, k ) = col ;
+        values( k++ ) = A.values[p] ;
+      }
+    }
+  }
+  A = sp_mat( locations, values, A.n_rows, A.n_cols ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- halfToFullStorage ---
+// =============================================================================
+// symmetric matrix full given by its half storage A, with one entry of each
+// symmetric pair (see computeHalfPattern), for the solvers and outputs that
+// need all the entries
+void halfToFullStorage( const sp_mat & A, sp_mat & full ){
+
+  uword nOffDiag = 0 ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      if ( A.row_indices[p] != col ){ nOffDiag++ ; }
+    }
+  }
+
+  umat locations( 2, A.n_nonzero + nOffDiag ) ;
+  vec  values( A.n_nonzero + nOffDiag ) ;
+  uword k = 0 ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      uword row = A.row_indices[p] ;
+      locations( 0, k ) = row ;  locations( 1, k ) = col ;  values( k++ ) = A.values[p] ;
+      if ( row != col ){
+        locations( 0, k ) = col ;  locations( 1, k ) = row ;  values( k++ ) = A.values[p] ;
+      }
+    }
+  }
+  full = sp_mat( locations, values, A.n_rows, A.n_cols ) ;
+}
+// =============================================================================
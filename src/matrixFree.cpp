@@ -0,0 +1,233 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// matrix-free tangent operator: the products of the reduced tangent matrix
+// are computed element by element, from the element matrices stored at the
+// tangent updates (tangentOperator 1) or computed again in each product
+// (tangentOperator 2), and the reduced tangent matrix is never assembled.
+
+#include "onsaspp.h"
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- forEachElementBatch ---
+// =============================================================================
+// calls work( group, elems, nElemsBatch ) for batches of at most
+// tetraBatchWidth tetrahedra. With the element colors the batches of a color
+// do not share nodes and run in parallel, otherwise they run in group order.
+template <class Work>
+static void forEachElementBatch( const modelData & model, \
+  const assemblyData & assembly, Work work ){
+
+  const long long W = tetraBatchWidth ;
+
+  if ( assembly.colorPtrs.n_elem > 1 ){
+    for ( uword color=1; color < assembly.colorPtrs.n_elem; color++){
+      uword group = assembly.colorGroups( color-1 ) ;
+      if ( model.groupType( group ) != 4 ){ continue ; }
+      long long first    = assembly.colorPtrs( color-1 ) ;
+      long long nInColor = assembly.colorPtrs( color ) - first ;
+      long long nBatches = ( nInColor + W - 1 ) / W ;
+      #pragma omp parallel for schedule(static)
+      for ( long long batch=0; batch < nBatches; batch++){
+        work( group, assembly.colorElems.memptr() + first + batch*W, \
+          (uword) min( W, nInColor - batch*W ) ) ;
+      }
+    }
+  }else{
+    for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+      if ( model.groupType( group ) != 4 ){ continue ; }
+      for ( uword first=model.groupPtrs( group ); first < model.groupPtrs( group+1 ); first += W){
+        work( group, model.groupElems.memptr() + first, \
+          (uword) min( (uword) W, model.groupPtrs( group+1 ) - first ) ) ;
+      }
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- tetraRedDofs ---
+// =============================================================================
+// reduced dofs of tetrahedron elem, 1-based, 0 for the fixed dofs
+void tetraRedDofs( const modelData & model, uword elem, uword * dofselemRed ){
+
+  tetraDofs( model, elem, dofselemRed ) ;
+  for ( int ind=0; ind < 12; ind++){
+    dofselemRed[ ind ] = model.dofsMap( dofselemRed[ ind ] - 1 ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- computeElemTangents ---
+// =============================================================================
+// internal forces in fs(0,0), as the assembler with paramOut 1, and, with
+// tangentOperator 1, the element tangent matrices at Ut: column elem of
+// elemKTe is KTe of element elem (column major), from one pass on the elements
+void computeElemTangents( const modelData & model, const assemblyData & assembly, \
+  const vec & Ut, field<vec> & fs, mat & elemKTe ){
+
+  if ( fs.n_elem < 3 ){ fs.set_size( 3, 1 ) ; }
+  vec & Fint = fs(0,0) ;  Fint.zeros( Ut.n_elem ) ;
+  fs(1,0).zeros( Ut.n_elem ) ;  fs(2,0).zeros( Ut.n_elem ) ;
+
+  bool store = assembly.tangentOperator == 1 ;
+  if ( store ){ elemKTe.zeros( 144, model.nElems ) ; }
+
+  double * FintPtr = Fint.memptr() ;
+  forEachElementBatch( model, assembly, [&]( uword group, const uword * elems, uword n ){
+    double Finte[ 12*tetraBatchWidth ], KTe[ 144*tetraBatchWidth ] ;
+    uword dofselem[ 12 ] ;
+    elementTangents( model, group, elems, n, Ut, assembly, Finte, KTe ) ;
+    for ( uword k=0; k < n; k++){
+      tetraDofs( model, elems[k], dofselem ) ;
+      for ( int ind=0; ind < 12; ind++){ FintPtr[ dofselem[ind]-1 ] += Finte[ 12*k + ind ] ; }
+      if ( store ){ std::copy( KTe + 144*k, KTe + 144*(k+1), elemKTe.colptr( elems[k] ) ) ; }
+    }
+  } ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- elementTangentsProduct ---
+// =============================================================================
+// y = K x for the reduced vectors x and y, with K the reduced tangent matrix
+// given by the stored element matrices elemKTe or, when it is empty, by the
+// element matrices at Ut computed for the product
+void elementTangentsProduct( const modelData & model, const assemblyData & assembly, \
+  const vec & Ut, const mat & elemKTe, const double * x, double * y ){
+
+  std::fill( y, y + model.redDofs.n_elem, 0.0 ) ;
+  bool stored = elemKTe.n_cols > 0 ;
+
+  forEachElementBatch( model, assembly, [&]( uword group, const uword * elems, uword n ){
+    double Finte[ 12*tetraBatchWidth ], KTe[ 144*tetraBatchWidth ] ;
+    if ( !stored ){ elementTangents( model, group, elems, n, Ut, assembly, Finte, KTe ) ; }
+    uword  red[ 12 ] ;
+    double xe[ 12 ] ;
+    for ( uword k=0; k < n; k++){
+      const double * Ke = stored ? elemKTe.colptr( elems[k] ) : KTe + 144*k ;
+      tetraRedDofs( model, elems[k], red ) ;
+      for ( int j=0; j < 12; j++){ xe[j] = ( red[j] > 0 ) ? x[ red[j]-1 ] : 0 ; }
+      for ( int i=0; i < 12; i++){
+        if ( red[i] == 0 ){ continue ; }
+        double s = 0 ;
+        for ( int j=0; j < 12; j++){ s += Ke[ i + 12*j ] * xe[j] ; }
+        y[ red[i]-1 ] += s ;
+      }
+    }
+  } ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- elementBlockJacobiSetup ---
+// =============================================================================
+// inverses of the diagonal blocks of the nodes (see preconditionerSetup),
+// summed from the element matrices as in elementTangentsProduct
+void elementBlockJacobiSetup( const modelData & model, const assemblyData & assembly, \
+  const vec & Ut, const mat & elemKTe, linearSolverData & solver ){
+
+  uword nBlocks = solver.blockPtrs.n_elem - 1 ;
+  blockInversesLayout( solver ) ;
+  solver.blockInvs.zeros() ;
+
+  uvec blockOf( model.redDofs.n_elem ) ;
+  for ( uword b=0; b < nBlocks; b++){
+    for ( uword i=solver.blockPtrs( b ); i < solver.blockPtrs( b+1 ); i++){ blockOf( i ) = b ; }
+  }
+
+  bool stored = elemKTe.n_cols > 0 ;
+  forEachElementBatch( model, assembly, [&]( uword group, const uword * elems, uword n ){
+    double Finte[ 12*tetraBatchWidth ], KTe[ 144*tetraBatchWidth ] ;
+    if ( !stored ){ elementTangents( model, group, elems, n, Ut, assembly, Finte, KTe ) ; }
+    uword red[ 12 ] ;
+    for ( uword k=0; k < n; k++){
+      const double * Ke = stored ? elemKTe.colptr( elems[k] ) : KTe + 144*k ;
+      tetraRedDofs( model, elems[k], red ) ;
+      for ( int j=0; j < 12; j++){
+        if ( red[j] == 0 ){ continue ; }
+        uword b = blockOf( red[j]-1 ), first = solver.blockPtrs( b ) ;
+        uword m = solver.blockPtrs( b+1 ) - first ;
+        double * block = solver.blockInvs.memptr() + solver.blockInvPtrs( b ) ;
+        for ( int i=0; i < 12; i++){
+          if ( red[i] == 0 || blockOf( red[i]-1 ) != b ){ continue ; }
+          block[ ( red[i]-1-first ) + m * ( red[j]-1-first ) ] += Ke[ i + 12*j ] ;
+        }
+      }
+    }
+  } ) ;
+
+  invertBlocks( solver ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- matrixFreeSolve ---
+// =============================================================================
+// solves K x = b with conjugate gradients (method 2) or MINRES (method 3) and
+// the element by element products of the tangent of version matrixVersion,
+// given by elemKTe or Ut (see elementTangentsProduct). The node blocks
+// Jacobi preconditioner is used for preconditioner 1 and 2, since the
+// smoothed aggregation hierarchy needs the assembled matrix, and is computed
+// again only when matrixVersion changes. Returns false when the solution is
+// not within the tolerance, see iterativeSolverConverged.
+bool matrixFreeSolve( const modelData & model, const assemblyData & assembly, \
+  const vec & Ut, const mat & elemKTe, unsigned int matrixVersion, \
+  const vec & b, double relTol, linearSolverData & solver, vec & x ){
+
+  bool jacobi = solver.preconditioner > 0 ;
+  if ( !solver.factorized || solver.factorizedVersion != matrixVersion ){
+    if ( jacobi ){ elementBlockJacobiSetup( model, assembly, Ut, elemKTe, solver ) ; }
+    solver.factorized = true ;  solver.factorizedVersion = matrixVersion ;
+    solver.nFactorizations++ ;
+  }
+
+  uword n = b.n_elem ;
+  linearOperator applyA = [&]( const double * v, double * Av ){
+    elementTangentsProduct( model, assembly, Ut, elemKTe, v, Av ) ;
+  } ;
+  linearOperator applyM = [&]( const double * r, double * z ){
+    if ( jacobi ){ applyBlockJacobi( solver, r, z ) ; }else{ std::copy( r, r+n, z ) ; }
+  } ;
+
+  if ( solver.method == 3 ){
+    minimalResidual( applyA, applyM, b, relTol, solver, x ) ;
+  }else{
+    conjugateGradient( applyA, applyM, b, relTol, solver, x ) ;
+  }
+  return iterativeSolverConverged( b, relTol, solver ) ;
+}
+// =============================================================================
@@ -0,0 +1,276 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+using namespace std  ;
+using namespace arma ;
+
+
+// =============================================================================
+// computeModelData
+// =============================================================================
+// builds, once at load time, the structure of arrays model store from the
+// ONSAS input matrices: the node coordinates by axis (read from the
+// interleaved columns of coordsElemsMat), the flat connectivity and the
+// element groups, sorted by ( type, material row, constitutive matrix flag )
+// and then by element number.
+void computeModelData( const imat & conec, const mat & coordsElemsMat, \
+  const mat & elementsParamsMat, uint nNodes, modelData & model ){
+
+  int nElems = conec.n_rows ;
+
+  model.nNodes = nNodes ;
+  model.nElems = nElems ;
+
+  // connectivity and coordinates
+  model.elemNodes.set_size( 4*nElems ) ;
+  model.nodeCoordsX.zeros( nNodes ) ;
+  model.nodeCoordsY.zeros( nNodes ) ;
+  model.nodeCoordsZ.zeros( nNodes ) ;
+
+  for ( int elem=1; elem <= nElems; elem++){
+    for ( int ind=1; ind <= 4; ind++){
+      int node = conec( elem-1, ind-1 ) ;
+      model.elemNodes( (elem-1)*4 + ind-1 ) = node - 1 ; // -1 if unused
+      if ( node > 0 ){
+        model.nodeCoordsX( node-1 ) = coordsElemsMat( elem-1, 2*( (ind-1)*3 + 1 ) - 2 ) ;
+        model.nodeCoordsY( node-1 ) = coordsElemsMat( elem-1, 2*( (ind-1)*3 + 2 ) - 2 ) ;
+        model.nodeCoordsZ( node-1 ) = coordsElemsMat( elem-1, 2*( (ind-1)*3 + 3 ) - 2 ) ;
+      }
+    }
+  }
+
+  // group key of each element
+  imat elemKeys( 3, nElems ) ;
+  for ( int elem=1; elem <= nElems; elem++){
+    int elemParamsRow = conec( elem-1, 6-1 )-1 ;
+    elemKeys( 0, elem-1 ) = elementsParamsMat( elemParamsRow, 1-1 ) ;
+    elemKeys( 1, elem-1 ) = conec( elem-1, 5-1 )-1 ;
+    elemKeys( 2, elem-1 ) = elementsParamsMat( elemParamsRow, 2-1 ) ;
+  }
+
+  auto keyLess = [&]( uword a, uword b ){
+    for ( int k=0; k < 3; k++){
+      if ( elemKeys( k, a ) != elemKeys( k, b ) ){ return elemKeys( k, a ) < elemKeys( k, b ) ; }
+    }
+    return false ;
+  } ;
+
+  vector<uword> order( nElems ) ;
+  for ( int elem=0; elem < nElems; elem++){ order[ elem ] = elem ; }
+  std::stable_sort( order.begin(), order.end(), keyLess ) ;
+
+  // groups
+  vector<uword> ptrs ;
+  model.groupElems.set_size( nElems ) ;
+  for ( int k=0; k < nElems; k++){
+    model.groupElems( k ) = order[ k ] ;
+    if ( k == 0 || keyLess( order[ k-1 ], order[ k ] ) ){
+      ptrs.push_back( k ) ;
+    }
+  }
+  ptrs.push_back( nElems ) ;
+
+  uword nGroups = ptrs.size() - 1 ;
+  model.groupPtrs.set_size( nGroups+1 ) ;
+  model.groupType.set_size( nGroups ) ;
+  model.groupMaterial.set_size( nGroups ) ;
+  model.groupConsMatFlag.set_size( nGroups ) ;
+  for ( uword g=0; g <= nGroups; g++){
+    model.groupPtrs( g ) = ptrs[ g ] ;
+    if ( g < nGroups ){
+      uword elem = order[ ptrs[ g ] ] ;
+      model.groupType       ( g ) = elemKeys( 0, elem ) ;
+      model.groupMaterial   ( g ) = elemKeys( 1, elem ) ;
+      model.groupConsMatFlag( g ) = elemKeys( 2, elem ) ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// computeDofsNumbering
+// =============================================================================
+// dofs numbering of the model. ONSAS numbers 6 dofs per node (displacement
+// and rotation for each axis, interleaved). When compactDofs is set and the
+// model only has solid (tetrahedra) and node elements, with no free
+// rotations, the model uses the 3 displacement dofs per node: node n (0-based)
+// has dofs dofsPerNode*n + transDofStep*(d-1) + 1, d = 1,2,3, in both
+// numberings. The nodes are numbered as in ONSAS unless renumberModel was
+// called. ONSAS vectors are translated only when read and written (see
+// dofsOnsasToModel). neumdofsOnsas (1-based, ONSAS numbering) gives
+// model.neumdofs in the model numbering, increasing, the dofs map of
+// computeDofsMap and model.onsasRedDofs, empty when the reduced dofs of
+// both numberings are in the same order.
+void computeDofsNumbering( const uvec & neumdofsOnsas, bool compactDofs, \
+  modelData & model ){
+
+  bool solidModel = compactDofs ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    solidModel = solidModel && ( model.groupType( group ) == 4 || model.groupType( group ) == 1 ) ;
+  }
+  for ( uword i=0; i < neumdofsOnsas.n_elem; i++){
+    solidModel = solidModel && ( ( neumdofsOnsas( i )-1 ) % 2 == 0 ) ;
+  }
+
+  model.dofsPerNode  = solidModel ? 3 : 6 ;
+  model.transDofStep = model.dofsPerNode / 3 ;
+
+  uvec neumdofs( neumdofsOnsas.n_elem ) ;
+  for ( uword i=0; i < neumdofsOnsas.n_elem; i++){
+    uword node = ( neumdofsOnsas( i )-1 ) / 6, comp = ( neumdofsOnsas( i )-1 ) % 6 ;
+    if ( !model.nodePermInv.is_empty() ){ node = model.nodePermInv( node ) ; }
+    neumdofs( i ) = model.dofsPerNode*node + comp / ( 6 / model.dofsPerNode ) + 1 ;
+  }
+  model.neumdofs = sort( neumdofs ) ;
+
+  computeDofsMap( model.neumdofs, model.dofsPerNode*model.nNodes, \
+    model.dofsMap, model.redDofs ) ;
+
+  // the ONSAS neumdofs may not be increasing even with the ONSAS numbering
+  model.onsasRedDofs.set_size( neumdofs.n_elem ) ;
+  bool identity = true ;
+  for ( uword i=0; i < neumdofs.n_elem; i++){
+    model.onsasRedDofs( i ) = model.dofsMap( neumdofs( i )-1 ) - 1 ;
+    identity = identity && model.onsasRedDofs( i ) == i ;
+  }
+  if ( identity ){ model.onsasRedDofs.reset() ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// symmetricTangent
+// =============================================================================
+// true when the tangent matrix of the model is symmetric: models of
+// tetrahedra (hyperelastic materials) and node elements, as the external
+// forces do not depend on the displacements and the inertia and damping
+// terms are symmetric. Elements or loads with non symmetric tangent matrices
+// must return false here.
+bool symmetricTangent( const modelData & model ){
+
+  bool symmetric = true ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    symmetric = symmetric && ( model.groupType( group ) == 4 || model.groupType( group ) == 1 ) ;
+  }
+  return symmetric ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// dofsOnsasToModel
+// =============================================================================
+// vector of the ONSAS numbering (6 dofs per node) to the model numbering
+void dofsOnsasToModel( const modelData & model, const vec & onsasVec, vec & modelVec ){
+
+  uword dpn = model.dofsPerNode, step = 6 / dpn ;
+  if ( dpn == 6 && model.nodePerm.is_empty() ){ modelVec = onsasVec ;  return ; }
+
+  modelVec.set_size( dpn*model.nNodes ) ;
+  for ( uword node=0; node < model.nNodes; node++){
+    uword onsasNode = model.nodePerm.is_empty() ? node : model.nodePerm( node ) ;
+    for ( uword c=0; c < dpn; c++){
+      modelVec( dpn*node + c ) = onsasVec( 6*onsasNode + step*c ) ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// dofsModelToOnsas
+// =============================================================================
+// vector of the model numbering to the ONSAS numbering, with zero rotations
+// when the model has 3 dofs per node
+void dofsModelToOnsas( const modelData & model, const vec & modelVec, vec & onsasVec ){
+
+  uword dpn = model.dofsPerNode, step = 6 / dpn ;
+  if ( dpn == 6 && model.nodePerm.is_empty() ){ onsasVec = modelVec ;  return ; }
+
+  onsasVec.zeros( 6*model.nNodes ) ;
+  for ( uword node=0; node < model.nNodes; node++){
+    uword onsasNode = model.nodePerm.is_empty() ? node : model.nodePerm( node ) ;
+    for ( uword c=0; c < dpn; c++){
+      onsasVec( 6*onsasNode + step*c ) = modelVec( dpn*node + c ) ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// reducedMatrixOnsasToModel
+// =============================================================================
+// reduced matrix, with the free dofs in the order of the ONSAS neumdofs, to
+// the reduced numbering of the model, in place. Both orders are the same
+// when model.onsasRedDofs is empty.
+void reducedMatrixOnsasToModel( const modelData & model, sp_mat & A ){
+
+  if ( A.n_rows != model.onsasRedDofs.n_elem ){ return ; }
+
+  umat locations( 2, A.n_nonzero ) ;
+  vec  values( A.n_nonzero ) ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      locations( 0, p ) = model.onsasRedDofs( A.row_indices[p] ) ;
+      locations( 1, p ) = model.onsasRedDofs( col ) ;
+      values( p ) = A.values[p] ;
+    }
+  }
+  A = sp_mat( locations, values, A.n_rows, A.n_cols ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// reducedMatrixModelToOnsas
+// =============================================================================
+// inverse of reducedMatrixOnsasToModel
+void reducedMatrixModelToOnsas( const modelData & model, sp_mat & A ){
+
+  if ( A.n_rows != model.onsasRedDofs.n_elem ){ return ; }
+
+  uvec onsasPos( model.onsasRedDofs.n_elem ) ;
+  for ( uword i=0; i < onsasPos.n_elem; i++){ onsasPos( model.onsasRedDofs( i ) ) = i ; }
+
+  umat locations( 2, A.n_nonzero ) ;
+  vec  values( A.n_nonzero ) ;
+  for ( uword col=0; col < A.n_cols; col++){
+    for ( uword p=A.col_ptrs[col]; p < A.col_ptrs[col+1]; p++){
+      locations( 0, p ) = onsasPos( A.row_indices[p] ) ;
+      locations( 1, p ) = onsasPos( col ) ;
+      values( p ) = A.values[p] ;
+    }
+  }
+  A = sp_mat( locations, values, A.n_rows, A.n_cols ) ;
+}
+// =============================================================================
@@ -0,0 +1,361 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// renumbering of the nodes and elements of the model at load time, for the
+// locality of the element gathers and scatters (reverse Cuthill-McKee) or the
+// fill of the factorization (minimum degree, nested dissection). The
+// numbering of ONSAS is kept in the input and output files, see
+// dofsOnsasToModel.
+
+#include "onsaspp.h"
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- nodeGraph ---
+// =============================================================================
+// adjacency of the nodes that share an element: the neighbours of node n are
+// adjNodes( adjPtrs(n) ... adjPtrs(n+1)-1 ), increasing and without n
+void nodeGraph( const modelData & model, uvec & adjPtrs, uvec & adjNodes ){
+
+  vector< vector<uword> > adj( model.nNodes ) ;
+  for ( uword elem=0; elem < model.nElems; elem++){
+    for ( int a=0; a < 4; a++){
+      int na = model.elemNodes( 4*elem + a ) ;
+      if ( na < 0 ){ continue ; }
+      for ( int b=0; b < 4; b++){
+        int nb = model.elemNodes( 4*elem + b ) ;
+        if ( nb >= 0 && nb != na ){ adj[ na ].push_back( nb ) ; }
+      }
+    }
+  }
+
+  adjPtrs.set_size( model.nNodes+1 ) ;
+  adjPtrs( 0 ) = 0 ;
+  for ( uword n=0; n < model.nNodes; n++){
+    std::sort( adj[n].begin(), adj[n].end() ) ;
+    adj[n].erase( std::unique( adj[n].begin(), adj[n].end() ), adj[n].end() ) ;
+    adjPtrs( n+1 ) = adjPtrs( n ) + adj[n].size() ;
+  }
+  adjNodes.set_size( adjPtrs( model.nNodes ) ) ;
+  for ( uword n=0; n < model.nNodes; n++){
+    std::copy( adj[n].begin(), adj[n].end(), adjNodes.begin() + adjPtrs( n ) ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- reverseCuthillMcKee ---
+// =============================================================================
+// breadth first numbering of each connected component, from a pseudo
+// peripheral node and visiting the neighbours by increasing degree, reversed.
+// Node order(k) is numbered k.
+void reverseCuthillMcKee( const uvec & adjPtrs, const uvec & adjNodes, uvec & order ){
+
+  uword nNodes = adjPtrs.n_elem - 1 ;
+  auto degree = [&]( uword n ){ return adjPtrs( n+1 ) - adjPtrs( n ) ; } ;
+
+  vector<uword> level( nNodes ) ;
+  vector<bool>  numbered( nNodes, false ) ;
+  vector<uword> result ;  result.reserve( nNodes ) ;
+  vector<uword> queue, neighbours ;
+
+  // breadth first search from root in the nodes not numbered: last level
+  // node of minimum degree, and number of levels
+  auto lastLevelNode = [&]( uword root, uword & nLevels ){
+    queue.assign( 1, root ) ;
+    vector<bool> seen( numbered ) ;  seen[ root ] = true ;  level[ root ] = 0 ;
+    for ( uword q=0; q < queue.size(); q++){
+      uword n = queue[q] ;
+      for ( uword p=adjPtrs( n ); p < adjPtrs( n+1 ); p++){
+        uword m = adjNodes( p ) ;
+        if ( !seen[m] ){ seen[m] = true ;  level[m] = level[n] + 1 ;  queue.push_back( m ) ; }
+      }
+    }
+    nLevels = level[ queue.back() ] + 1 ;
+    uword best = queue.back() ;
+    for ( uword n : queue ){
+      if ( level[n] == nLevels-1 && degree( n ) < degree( best ) ){ best = n ; }
+    }
+    return best ;
+  } ;
+
+  for ( uword start=0; start < nNodes; start++){
+    if ( numbered[ start ] ){ continue ; }
+
+    // pseudo peripheral node of the component of start
+    uword root = start ;
+    uword nLevels, candidateLevels ;
+    uword candidate = lastLevelNode( root, nLevels ) ;
+    for ( int it=0; it < 5; it++){
+      lastLevelNode( candidate, candidateLevels ) ;
+      if ( candidateLevels <= nLevels ){ break ; }
+      root = candidate ;  nLevels = candidateLevels ;
+      candidate = lastLevelNode( root, nLevels ) ;
+    }
+
+    // Cuthill-McKee numbering of the component
+    uword first = result.size() ;
+    result.push_back( root ) ;  numbered[ root ] = true ;
+    for ( uword q=first; q < result.size(); q++){
+      uword n = result[q] ;
+      neighbours.clear() ;
+      for ( uword p=adjPtrs( n ); p < adjPtrs( n+1 ); p++){
+        if ( !numbered[ adjNodes( p ) ] ){ neighbours.push_back( adjNodes( p ) ) ; }
+      }
+      std::stable_sort( neighbours.begin(), neighbours.end(), \
+        [&]( uword a, uword b ){ return degree( a ) < degree( b ) ; } ) ;
+      for ( uword m : neighbours ){ numbered[m] = true ;  result.push_back( m ) ; }
+    }
+  }
+
+  order.set_size( nNodes ) ;
+  for ( uword k=0; k < nNodes; k++){ order( k ) = result[ nNodes-1-k ] ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- nestedDissection ---
+// =============================================================================
+// geometric nested dissection: the nodes are split by the median coordinate
+// of the axis of largest extent, the nodes of the lower half adjacent to the
+// upper half are the separator, numbered after both halves, and the halves
+// are split again until they have less than minNodes nodes, numbered by
+// minimum degree. Node order(k) is numbered k.
+void nestedDissection( const modelData & model, const uvec & adjPtrs, \
+  const uvec & adjNodes, uvec & order ){
+
+  const uword minNodes = 64 ;
+  uword nNodes = model.nNodes ;
+  const vec * coords[3] = { &model.nodeCoordsX, &model.nodeCoordsY, &model.nodeCoordsZ } ;
+
+  vector<uword> result ;  result.reserve( nNodes ) ;
+  vector<uword> part( nNodes, 0 ) ; // 1 lower half, 2 upper half of the current split
+  vector<uword> local( nNodes ) ;
+
+  // nodes of a part of the current split, subgraph minimum degree ordering
+  auto orderLeaf = [&]( const vector<uword> & nodes ){
+    uword m = nodes.size() ;
+    for ( uword k=0; k < m; k++){ local[ nodes[k] ] = k ; }
+    vector<uword> colPtrs( 1, 0 ), rowInds ;
+    for ( uword n : nodes ){
+      for ( uword p=adjPtrs( n ); p < adjPtrs( n+1 ); p++){
+        uword o = adjNodes( p ) ;
+        if ( local[o] < m && nodes[ local[o] ] == o ){ rowInds.push_back( local[o] ) ; }
+      }
+      colPtrs.push_back( rowInds.size() ) ;
+    }
+    uvec leafPerm ;
+    minimumDegreeOrdering( conv_to<uvec>::from( colPtrs ), conv_to<uvec>::from( rowInds ), \
+      regspace<uvec>( 0, m-1 ), leafPerm ) ;
+    for ( uword k=0; k < m; k++){ result.push_back( nodes[ leafPerm( k ) ] ) ; }
+  } ;
+
+  // parts to number, the last one first: a split part pushes its
+  // separator, upper and lower halves, so the separator follows both
+  struct task { vector<uword> nodes ;  bool separator ; } ;
+  vector<task> stack ;
+
+  stack.push_back( { vector<uword>( nNodes ), false } ) ;
+  for ( uword n=0; n < nNodes; n++){ stack.back().nodes[n] = n ; }
+
+  while ( !stack.empty() ){
+    task t = std::move( stack.back() ) ;
+    stack.pop_back() ;
+
+    if ( t.separator || t.nodes.size() < minNodes ){
+      if ( !t.nodes.empty() ){ orderLeaf( t.nodes ) ; }
+      continue ;
+    }
+
+    // axis of largest extent and median
+    int axis = 0 ;  double extent = -1, lowest = 0 ;
+    for ( int d=0; d < 3; d++){
+      double lo = datum::inf, hi = -datum::inf ;
+      for ( uword n : t.nodes ){ lo = min( lo, (*coords[d])( n ) ) ;  hi = max( hi, (*coords[d])( n ) ) ; }
+      if ( hi - lo > extent ){ extent = hi - lo ;  axis = d ;  lowest = lo ; }
+    }
+    vector<double> values( t.nodes.size() ) ;
+    for ( uword k=0; k < t.nodes.size(); k++){ values[k] = (*coords[axis])( t.nodes[k] ) ; }
+    std::nth_element( values.begin(), values.begin() + values.size()/2, values.end() ) ;
+    double median = values[ values.size()/2 ] ;
+
+    // nodes on the median plane in the upper half, or in the lower one if
+    // the upper one would have all the nodes
+    bool closed = lowest == median ;
+    uword nUpper = 0 ;
+    for ( uword n : t.nodes ){
+      double c = (*coords[axis])( n ) ;
+      part[n] = ( closed ? c > median : c >= median ) ? 2 : 1 ;
+      nUpper += part[n] == 2 ;
+    }
+    if ( nUpper == 0 ){
+      for ( uword n : t.nodes ){ part[n] = 0 ; }
+      orderLeaf( t.nodes ) ;
+      continue ;
+    }
+
+    vector<uword> lower, upper, separator ;
+    for ( uword n : t.nodes ){
+      if ( part[n] == 2 ){ upper.push_back( n ) ;  continue ; }
+      bool touches = false ;
+      for ( uword p=adjPtrs( n ); p < adjPtrs( n+1 ) && !touches; p++){
+        touches = part[ adjNodes( p ) ] == 2 ;
+      }
+      ( touches ? separator : lower ).push_back( n ) ;
+    }
+    for ( uword n : t.nodes ){ part[n] = 0 ; }
+
+    stack.push_back( { separator, true } ) ;
+    stack.push_back( { upper, false } ) ;
+    stack.push_back( { lower, false } ) ;
+  }
+
+  order = conv_to<uvec>::from( result ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- nodeOrderingStats ---
+// =============================================================================
+// statistics of the numbering of the nodes graph (see nodeGraph): bandwidth,
+// profile (sum over the nodes of the distance to the first neighbour) and
+// number of entries of the factor L of the graph eliminated in this order
+void nodeOrderingStats( const modelData & model, uword & bandwidth, \
+  uword & profile, uword & factorNnz ){
+
+  uvec adjPtrs, adjNodes ;
+  nodeGraph( model, adjPtrs, adjNodes ) ;
+  uword nNodes = model.nNodes ;
+
+  bandwidth = 0 ;  profile = 0 ;  factorNnz = 0 ;
+  vector<long long> parent( nNodes, -1 ) ;
+  vector<uword> flag( nNodes ) ;
+  for ( uword k=0; k < nNodes; k++){
+    flag[k] = k ;
+    if ( adjPtrs( k ) < adjPtrs( k+1 ) && adjNodes( adjPtrs( k ) ) < k ){
+      profile += k - adjNodes( adjPtrs( k ) ) ;
+    }
+    for ( uword p=adjPtrs( k ); p < adjPtrs( k+1 ); p++){
+      uword i = adjNodes( p ) ;
+      if ( i >= k ){ break ; }
+      bandwidth = max( bandwidth, k - i ) ;
+      // path in the elimination tree, see linearSolverAnalysis
+      for ( ; i < k && flag[i] != k; i = parent[i] ){
+        if ( parent[i] == -1 ){ parent[i] = k ; }
+        factorNnz++ ;
+        flag[i] = k ;
+      }
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- renumberModel ---
+// =============================================================================
+// renumbers the nodes of the model with the ordering 1 reverse Cuthill-McKee,
+// 2 minimum degree or 3 nested dissection, and the elements of each group by
+// their first node in the new numbering, so that the groups are contiguous
+// and consecutive elements share nodes. Called after computeModelData and
+// before computeDofsNumbering; the ONSAS numbers of the nodes and elements
+// are kept in model.nodePerm and model.elemPerm.
+void renumberModel( modelData & model, uint ordering ){
+
+  uword nNodes = model.nNodes ;
+
+  uvec adjPtrs, adjNodes, order ;
+  nodeGraph( model, adjPtrs, adjNodes ) ;
+  if ( ordering == 1 ){
+    reverseCuthillMcKee( adjPtrs, adjNodes, order ) ;
+  }else if ( ordering == 2 ){
+    minimumDegreeOrdering( adjPtrs, adjNodes, regspace<uvec>( 0, nNodes-1 ), order ) ;
+  }else if ( ordering == 3 ){
+    nestedDissection( model, adjPtrs, adjNodes, order ) ;
+  }else{
+    return ;
+  }
+
+  permuteModelNodes( model, order ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- permuteModelNodes ---
+// =============================================================================
+// new numbering of the nodes, model node k being the node order(k), and of
+// the elements of each group by their first node, see renumberModel. Also
+// used to renumber the model as in a checkpoint (see sessionSetup).
+void permuteModelNodes( modelData & model, const uvec & order ){
+
+  uword nNodes = model.nNodes, nElems = model.nElems ;
+
+  // nodes
+  uvec newNode( nNodes ) ;
+  for ( uword k=0; k < nNodes; k++){ newNode( order( k ) ) = k ; }
+  model.nodeCoordsX = model.nodeCoordsX.elem( order ) ;
+  model.nodeCoordsY = model.nodeCoordsY.elem( order ) ;
+  model.nodeCoordsZ = model.nodeCoordsZ.elem( order ) ;
+  model.nodePerm = model.nodePerm.is_empty() ? order : uvec( model.nodePerm.elem( order ) ) ;
+  model.nodePermInv.set_size( nNodes ) ;
+  for ( uword k=0; k < nNodes; k++){ model.nodePermInv( model.nodePerm( k ) ) = k ; }
+
+  // elements, by group and first node
+  vector<uword> firstNode( nElems ) ;
+  for ( uword elem=0; elem < nElems; elem++){
+    firstNode[ elem ] = nNodes ;
+    for ( int a=0; a < 4; a++){
+      int node = model.elemNodes( 4*elem + a ) ;
+      if ( node >= 0 ){ firstNode[ elem ] = min( firstNode[ elem ], newNode( node ) ) ; }
+    }
+  }
+  uvec elemOrder( nElems ) ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    uword * first = model.groupElems.memptr() + model.groupPtrs( group ) ;
+    uword * last  = model.groupElems.memptr() + model.groupPtrs( group+1 ) ;
+    std::stable_sort( first, last, [&]( uword a, uword b ){ return firstNode[a] < firstNode[b] ; } ) ;
+  }
+  elemOrder = model.groupElems ;
+
+  Col<s32> elemNodes( 4*nElems ) ;
+  for ( uword k=0; k < nElems; k++){
+    for ( int a=0; a < 4; a++){
+      int node = model.elemNodes( 4*elemOrder( k ) + a ) ;
+      elemNodes( 4*k + a ) = ( node >= 0 ) ? (s32) newNode( node ) : -1 ;
+    }
+  }
+  model.elemNodes  = elemNodes ;
+  model.elemPerm   = model.elemPerm.is_empty() ? elemOrder : uvec( model.elemPerm.elem( elemOrder ) ) ;
+  model.groupElems = regspace<uvec>( 0, nElems-1 ) ;
+}
+// =============================================================================
@@ -0,0 +1,641 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ONSASPP_H
+#define ONSASPP_H
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <armadillo>
+
+// number of elements computed together by the batched element kernels
+const int tetraBatchWidth = 8 ;
+
+// relative residual accepted from the iterative methods, over the requested
+// tolerance, see iterativeSolverConverged
+const double iterativeSolverTolFactor = 10 ;
+
+// product y = A x of a linear operator on raw vectors, see conjugateGradient
+typedef std::function<void( const double * x, double * y )> linearOperator ;
+
+// =============================================================================
+// modelData
+// =============================================================================
+// the problem solved, read and built once at load time and then passed by
+// const reference: mesh and element data in structure of arrays form (built
+// by computeModelData, nodes and elements 0-based), parameters, loads and
+// boundary conditions.
+struct modelData {
+  unsigned int nNodes = 0, nElems = 0 ;
+
+  arma::vec nodeCoordsX, nodeCoordsY, nodeCoordsZ ; // reference coordinates
+  arma::Col<arma::s32> elemNodes ; // element e: 4*e ... 4*e+3, -1 if unused
+
+  // element groups, with the same ( type, material row, constitutive matrix
+  // flag ): the elements of group g are groupElems( groupPtrs(g) ...
+  // groupPtrs(g+1)-1 ), in increasing order
+  arma::uvec groupPtrs, groupElems ;
+  arma::Col<arma::s32> groupType, groupMaterial, groupConsMatFlag ;
+
+  arma::mat materialsParamsMat, elementsParamsMat, crossSecsParamsMat ;
+  arma::vec numericalMethodParams ;
+  double    nodalDispDamping = 0 ;
+  arma::sp_mat KS ; // ONSAS numbering, not used by the assembler
+
+  arma::vec constantFext, variableFext ;
+
+  // nodes and elements numbering, see renumberModel: model node k is the
+  // ONSAS node nodePerm(k) and model element k the ONSAS element elemPerm(k),
+  // 0-based, empty when the ONSAS numbering is kept
+  arma::uvec nodePerm, nodePermInv, elemPerm ;
+
+  // dofs numbering, see computeDofsNumbering
+  unsigned int dofsPerNode = 6, transDofStep = 2 ;
+  arma::uvec neumdofs ;          // free dofs, 1-based
+  arma::uvec dofsMap, redDofs ;  // see computeDofsMap
+  arma::uvec onsasRedDofs ;      // reduced dof of the i-th ONSAS free dof, 0-based,
+                                 // empty when it is i
+};
+// =============================================================================
+
+
+// =============================================================================
+// linearSolverData
+// =============================================================================
+// solver of the reduced systems, kept for the whole run. For the sparse LDL'
+// factorization the fill reducing ordering and the symbolic factorization
+// are computed once (see linearSolverAnalysis) and the numeric factorization
+// is recomputed only when the matrix changes (see linearSolverSolve). For the
+// iterative methods the same holds for the preconditioner (see
+// iterativeSolverSolve).
+struct linearSolverData {
+  unsigned int method = 1 ; // 0 spsolve, 1 LDL' with reused analysis,
+                            // 2 conjugate gradients, 3 MINRES
+
+  bool analysed = false ;
+  bool naturalOrder = false ; // dofs eliminated in the model order
+  bool halfStored   = false ; // one entry of each symmetric pair, see computeHalfPattern
+  arma::uvec dofBlocks      ; // dofs ordered together, see minimumDegreeOrdering
+  arma::uvec perm, permInv  ; // dof perm(k) is the k-th eliminated
+  arma::uvec colPtrs, rowInds ; // analysed pattern
+  arma::ivec parent         ; // elimination tree, -1 for the roots
+  arma::uvec Lp             ; // columns of L: Li, Lx( Lp(j) ... Lp(j)+Lnz(j)-1 )
+
+  // factorization, or preconditioner, of the matrix of version factorizedVersion
+  bool factorized = false ;
+  unsigned int factorizedVersion = 0, nFactorizations = 0 ;
+  unsigned int nNegPivots = 0 ; // negative eigenvalues of the factorized matrix
+  arma::uvec Lnz, Li ;
+  arma::vec  Lx, D ;
+
+  arma::vec  work ; // zero between calls
+  arma::uvec flag, pattern ;
+
+  // iterative methods
+  unsigned int preconditioner = 2 ; // 0 none, 1 Jacobi of the node blocks,
+                                    // 2 smoothed aggregation multigrid
+  double relTol = 0 ;               // 0 for Eisenstat-Walker forcing terms
+  unsigned int maxIts = 1000 ;
+  double forcingTerm = 0, prevNormRHS = 0 ; // see computeForcingTerm
+  unsigned int lastIters = 0 ;  double lastRelRes = 0 ;
+
+  arma::uvec blockPtrs ; // dofs of the nodes: blockPtrs(b) ... blockPtrs(b+1)-1
+  arma::mat  nullSpace ; // rigid body modes of the free dofs
+  arma::uvec blockInvPtrs ;  arma::vec blockInvs ; // inverses of the node blocks
+  std::vector<arma::sp_mat> amgTentP, amgP, amgA ; // see amgSetup
+  std::vector<arma::vec>    amgDiagInv, amgX, amgB, amgRes ;
+  arma::mat amgCoarseInv, krylovWork ;
+};
+// =============================================================================
+
+
+// =============================================================================
+// solverState
+// =============================================================================
+// state of the time step iteration, updated in place by the solver functions:
+// converged values at time t, Newton iterate at t+1 and the linear system of
+// the current iteration.
+struct solverState {
+  double currLoadFactor = 0, nextLoadFactor = 0 ;
+  double currTime = 0, nextTime = 0 ;
+  unsigned int timeIndex = 0 ;
+
+  arma::vec Ut, Udott, Udotdott ;          // at time t
+  arma::vec Utp1k, Udottp1k, Udotdottp1k ; // iterate k at time t+1
+
+  arma::vec    FextG ;
+  arma::vec    systemDeltauRHS, deltaured ;
+  arma::sp_mat systemDeltauMatrix ;
+  unsigned int matrixVersion = 0 ; // increased when the tangent changes
+  bool linearSolveFailed = false ; // deltaured not a solution, see solveTangentSystem
+  arma::mat elemTangents ; // matrix-free tangent, see computeElemTangents
+  arma::vec Utangent     ; // iterate of the matrix-free tangent
+  linearSolverData linearSolver ;
+
+  // quasi-Newton pairs of increments and residual changes, columns of a
+  // circular buffer with the next pair stored in column qnNext
+  arma::mat qnSteps, qnResChanges ;
+  arma::vec qnRho ;
+  unsigned int qnPairs = 0, qnNext = 0 ;
+
+  arma::field<arma::vec>    fs ; // assembler outputs, reused by every assembly
+  arma::field<arma::sp_mat> ks ;
+};
+// =============================================================================
+
+
+// =============================================================================
+// assemblyData
+// =============================================================================
+// data computed once per run and used by every assembly: the reference
+// geometry of the elements, the CSC pattern of the reduced tangent matrix,
+// the slots of the element entries in its values array and the parallel
+// schedule of the elements.
+struct assemblyData {
+  arma::mat elemFunders       ; // see computeElemGeometry
+  arma::vec elemVols          ;
+
+  arma::uvec colPtrs, rowInds ; // CSC pattern of the reduced tangent matrix
+  arma::Mat<arma::u32> elemSlots ; // 32 bit, see computeSparsityPattern
+
+  unsigned int strategy = 0   ; // 0 serial, 1 coloring, 2 partial buffers
+  unsigned int nParts   = 1   ; // element parts of the partial buffers strategy
+  arma::umat partRanges       ; // see computePartRanges
+  arma::uvec colorPtrs, colorElems, colorGroups ; // see computeElemColors
+  unsigned int batchedKernel = 1 ; // SVK tetrahedra by elementTetraSVKBatch
+  unsigned int tangentOperator = 0 ; // 0 assembled matrix, matrix-free with
+                                     // 1 stored or 2 recomputed element matrices
+};
+// =============================================================================
+
+
+// =============================================================================
+// dataFile
+// =============================================================================
+// binary container of dense, index and compressed column sparse matrices, written
+// from the sections added or mapped in memory when read, see dataFile.cpp
+struct dataFileSection {
+  std::string name ;
+  unsigned int type = 0 ; // 0 dense, 1 sparse, 2 index
+  arma::uword nRows = 0, nCols = 0, nnz = 0 ; // nnz = nRows*nCols if not sparse
+  const double      * values  = nullptr ;
+  const arma::uword * indices = nullptr ; // of the index matrices
+  const arma::uword * colPtrs = nullptr, * rowInds = nullptr ;
+};
+
+struct dataFile {
+  std::vector<dataFileSection> sections ;
+  void * map = nullptr ;  size_t mapBytes = 0 ; // of the file read
+};
+// =============================================================================
+
+
+// =============================================================================
+// solverLog
+// =============================================================================
+// increments log of the time steps, see printSolverOutput: the records not
+// yet written to the file path (none if empty) are the count records of the
+// ring buffer from first
+const size_t solverLogCapacity = 1024 ;
+
+struct solverLogRecord {
+  unsigned int type = 0, timeIndex = 0, iters = 0, stopCrit = 0 ;
+  double loadFactor = 0, normRHS = 0, normDeltau = 0 ;
+};
+
+struct solverLog {
+  std::string  path ;
+  unsigned int format = 1, verbosity = 2 ; // see extractCppSolverParams
+  std::vector<solverLogRecord> records ;
+  size_t first = 0, count = 0 ;
+  bool   started = false ; // file created or appended by this run
+};
+// =============================================================================
+
+
+// =============================================================================
+// solverSession
+// =============================================================================
+// problem, assembly data and solver state kept for all the time steps solved
+// in the same process, see session.cpp
+struct solverSession {
+  modelData    model    ;
+  assemblyData assembly ;
+  solverState  state    ;
+  std::string  outputDir, problemName ; // of the iterations output file
+  unsigned int loadSteps = 0, outputInterval = 1 ; // see extractCppSolverParams
+  unsigned int tangentFiles = 0, checkpointInterval = 0, restart = 0 ;
+  unsigned int resultsInterval = 0, resultsStresses = 0 ;
+  solverLog    log ;
+  dataFile restartFile ; // checkpoint read by sessionSetup, see sessionRestoreState
+  bool tangentSet = false ; // by sessionSetTangent, for the next step
+};
+// =============================================================================
+
+
+// =============================================================================
+// sessionCheckpointData
+// =============================================================================
+// checkpoint of a session written by a thread, see sessionCheckpoint: the
+// sections of the file and the copies of the state they point to
+struct sessionCheckpointData {
+  dataFile file ;
+  arma::vec setup, step, U, Udot, Udotdot ;
+  arma::sp_mat tangent ;
+  arma::uvec ldlPerm, ldlBlocks, ldlLp ;
+  arma::vec  ldlParent ;
+  arma::umat elemSlots ; // the index sections of dataFile have 64 bits
+  std::thread writer ;
+};
+// =============================================================================
+
+
+// =============================================================================
+// resultsWriter
+// =============================================================================
+// results of the time steps written by a thread, see resultsWriter.cpp: the
+// tetrahedra of the mesh, two buffers of step values, one filled by
+// resultsWriterPush while the other is written, and the steps in the files
+struct resultsWriter {
+  std::string  xdmfPath, rawPath, rawName ;
+  bool         stresses = false ;
+  arma::uword  nNodes = 0, nCells = 0, rawBytes = 0 ;
+  arma::uword  geometrySeek = 0, topologySeek = 0, elementsSeek = 0 ;
+  arma::uvec   cellElems ;  // model element of each cell, by groups
+
+  arma::vec    buffers[ 2 ] ;  // displacements, then stresses if written
+  double       bufferTimes[ 2 ] = { 0, 0 } ;
+  bool         busy[ 2 ] = { false, false } ;
+  unsigned int next = 0 ;
+  std::deque<unsigned int> queue ;
+  bool         stop = false ;
+  std::string  error ;  // first error of the thread, it then writes no steps
+
+  std::vector<double>      times ;      // written by the thread
+  std::vector<arma::uword> stepSeeks ;
+
+  std::mutex              mutex   ;
+  std::condition_variable changed ;
+  std::thread             writer  ;
+};
+// =============================================================================
+
+
+// --- model.cpp ---
+void computeModelData( const arma::imat & conec, const arma::mat & coordsElemsMat, \
+  const arma::mat & elementsParamsMat, unsigned int nNodes, modelData & model ) ;
+
+void computeDofsNumbering( const arma::uvec & neumdofsOnsas, bool compactDofs, \
+  modelData & model ) ;
+
+bool symmetricTangent( const modelData & model ) ;
+
+void dofsOnsasToModel( const modelData & model, const arma::vec & onsasVec, \
+  arma::vec & modelVec ) ;
+
+void dofsModelToOnsas( const modelData & model, const arma::vec & modelVec, \
+  arma::vec & onsasVec ) ;
+
+void reducedMatrixOnsasToModel( const modelData & model, arma::sp_mat & A ) ;
+
+void reducedMatrixModelToOnsas( const modelData & model, arma::sp_mat & A ) ;
+
+
+// --- nodeOrdering.cpp ---
+void nodeGraph( const modelData & model, arma::uvec & adjPtrs, arma::uvec & adjNodes ) ;
+
+void reverseCuthillMcKee( const arma::uvec & adjPtrs, const arma::uvec & adjNodes, \
+  arma::uvec & order ) ;
+
+void nestedDissection( const modelData & model, const arma::uvec & adjPtrs, \
+  const arma::uvec & adjNodes, arma::uvec & order ) ;
+
+void nodeOrderingStats( const modelData & model, arma::uword & bandwidth, \
+  arma::uword & profile, arma::uword & factorNnz ) ;
+
+void renumberModel( modelData & model, unsigned int ordering ) ;
+
+void permuteModelNodes( modelData & model, const arma::uvec & order ) ;
+
+
+// --- elements.cpp ---
+arma::mat shapeFunsDeriv ( double x, double y, double z ) ;
+
+void cosseratSVK ( const arma::vec & consParams, const arma::mat & Egreen, \
+  int consMatFlag, arma::mat & S, arma::mat & ConsMat ) ;
+
+arma::mat BgrandeMats ( const arma::mat & deriv , const arma::mat & F ) ;
+
+arma::vec mat2voigt( const arma::mat & Tensor, double factor ) ;
+
+void tetraGeometry( const arma::vec & elemCoords, arma::mat & funder, \
+  double & vol ) ;
+
+void computeElemGeometry( const modelData & model, arma::mat & elemFunders, \
+  arma::vec & elemVols ) ;
+
+void elementTetraSolid( const arma::mat & funder, double vol, \
+  const arma::vec & elemDisps, const arma::vec & elemConstitutiveParams, int paramOut, int consMatFlag, \
+  double elemrho, arma::vec & Finte, arma::mat & KTe ) ;
+
+void elementTetraSVK( const double * funder, double vol, const double * elemDisps, \
+  double young, double nu, int paramOut, int consMatFlag, \
+  arma::vec::fixed<12> & Finte, arma::mat::fixed<12,12> & KTe ) ;
+
+void elementTetraSVKStress( const double * funder, const double * elemDisps, \
+  double young, double nu, double * Svoigt ) ;
+
+
+// --- elementsBatch.cpp ---
+const char * tetraSVKBatchISA() ;
+
+void elementTetraSVKBatch( const double * funder, const double * vol, \
+  const double * elemDisps, double young, double nu, int paramOut, \
+  int consMatFlag, double * Finte, double * KTe ) ;
+
+
+// --- assembler.cpp ---
+arma::ivec nodes2dofs( const arma::ivec & nodes, int degreesPerNode ) ;
+
+void computeDofsMap( const arma::uvec & neumdofs, unsigned int nDofs, \
+  arma::uvec & dofsMap, arma::uvec & redDofs ) ;
+
+void computeSparsityPattern( const modelData & model, const arma::uvec & dofsMap, \
+  unsigned int nRedDofs, arma::uvec & colPtrs, \
+  arma::uvec & rowInds, arma::Mat<arma::u32> & elemSlots ) ;
+
+void computeHalfPattern( const arma::uvec & permInv, arma::uvec & colPtrs, \
+  arma::uvec & rowInds, arma::Mat<arma::u32> & elemSlots ) ;
+
+arma::ivec elementTypeInfo( int elemType ) ;
+
+void computeElemColors( const modelData & model, arma::uvec & colorPtrs, \
+  arma::uvec & colorElems, arma::uvec & colorGroups ) ;
+
+void computePartRanges( const modelData & model, assemblyData & assembly ) ;
+
+void scatterElement( int elem, const arma::uword * dofselemRed, \
+  const double * Finte, const double * KTe, int stride, int paramOut, \
+  const assemblyData & assembly, double * Fint, double * valsKT, \
+  arma::uword firstDof, arma::uword firstSlot ) ;
+
+void tetraDofs( const modelData & model, arma::uword elem, arma::uword * dofselem ) ;
+
+void elementTangents( const modelData & model, arma::uword group, \
+  const arma::uword * elems, arma::uword nElemsRange, const arma::vec & Ut, \
+  const assemblyData & assembly, double * Finte, double * KTe ) ;
+
+void assembleGroupElements( const modelData & model, arma::uword group, \
+  const arma::uword * elems, arma::uword nElemsRange, const arma::vec & Ut, \
+  int paramOut, const assemblyData & assembly, double * Fint, double * valsKT, \
+  arma::uword firstDof, arma::uword firstSlot ) ;
+
+void assembler( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & Ut, const arma::vec & Udott, const arma::vec & Udotdott, \
+  int paramOut, arma::field<arma::vec> & fs, arma::field<arma::sp_mat> & ks ) ;
+
+
+// --- linearSolver.cpp ---
+void minimumDegreeOrdering( const arma::uvec & colPtrs, const arma::uvec & rowInds, \
+  const arma::uvec & dofBlocks, arma::uvec & perm ) ;
+
+void linearSolverAnalysis( const arma::uvec & colPtrs, const arma::uvec & rowInds, \
+  const arma::uvec & dofBlocks, linearSolverData & solver ) ;
+
+void linearSolverAnalysisRestore( const arma::uvec & colPtrs, const arma::uvec & rowInds, \
+  const arma::uvec & dofBlocks, const arma::uvec & perm, const arma::ivec & parent, \
+  const arma::uvec & Lp, linearSolverData & solver ) ;
+
+void linearSolverSetup( const modelData & model, const assemblyData & assembly, \
+  linearSolverData & solver ) ;
+
+bool linearSolverFactorize( const arma::sp_mat & A, linearSolverData & solver ) ;
+
+bool linearSolverSolve( const arma::sp_mat & A, unsigned int matrixVersion, \
+  const arma::vec & b, linearSolverData & solver, arma::vec & x ) ;
+
+double linearSolverBytes( const linearSolverData & solver ) ;
+
+void fullToHalfStorage( const arma::uvec & permInv, arma::sp_mat & A ) ;
+
+void halfToFullStorage( const arma::sp_mat & A, arma::sp_mat & full ) ;
+
+
+// --- iterativeSolver.cpp ---
+void sparseTransposeProduct( const arma::sp_mat & M, const double * x, double * y ) ;
+
+void sparseProductAdd( const arma::sp_mat & M, const double * x, double * y ) ;
+
+void sparseTranspose( const arma::sp_mat & M, arma::sp_mat & Mt ) ;
+
+void sparseProduct( const arma::sp_mat & A, const arma::sp_mat & B, arma::sp_mat & C ) ;
+
+void aggregateBlocks( const arma::sp_mat & A, const arma::uvec & blockPtrs, \
+  double theta, arma::uvec & aggregates, arma::uword & nAggregates ) ;
+
+void tentativeProlongator( const arma::uvec & blockPtrs, const arma::uvec & aggregates, \
+  arma::uword nAggregates, const arma::mat & B, arma::sp_mat & Pt, \
+  arma::uvec & coarseBlockPtrs, arma::mat & coarseB ) ;
+
+void smoothedProlongator( const arma::sp_mat & A, const arma::vec & diagInv, \
+  const arma::sp_mat & Pt, arma::sp_mat & P ) ;
+
+void amgSetup( const arma::sp_mat & A, linearSolverData & solver ) ;
+
+void amgCycle( const arma::sp_mat & A, arma::uword l, linearSolverData & solver ) ;
+
+void blockInversesLayout( linearSolverData & solver ) ;
+
+void invertBlocks( linearSolverData & solver ) ;
+
+void preconditionerSetup( const arma::sp_mat & A, linearSolverData & solver ) ;
+
+void applyBlockJacobi( const linearSolverData & solver, const double * r, double * z ) ;
+
+void applyPreconditioner( const arma::sp_mat & A, linearSolverData & solver, \
+  const double * r, double * z ) ;
+
+void conjugateGradient( const linearOperator & applyA, const linearOperator & applyM, \
+  const arma::vec & b, double relTol, linearSolverData & solver, arma::vec & x ) ;
+
+void minimalResidual( const linearOperator & applyA, const linearOperator & applyM, \
+  const arma::vec & b, double relTol, linearSolverData & solver, arma::vec & x ) ;
+
+bool iterativeSolverSolve( const arma::sp_mat & A, unsigned int matrixVersion, \
+  const arma::vec & b, double relTol, linearSolverData & solver, arma::vec & x ) ;
+
+bool iterativeSolverConverged( const arma::vec & b, double relTol, \
+  const linearSolverData & solver ) ;
+
+
+// --- matrixFree.cpp ---
+void tetraRedDofs( const modelData & model, arma::uword elem, arma::uword * dofselemRed ) ;
+
+void computeElemTangents( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & Ut, arma::field<arma::vec> & fs, arma::mat & elemKTe ) ;
+
+void elementTangentsProduct( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & Ut, const arma::mat & elemKTe, const double * x, double * y ) ;
+
+void elementBlockJacobiSetup( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & Ut, const arma::mat & elemKTe, linearSolverData & solver ) ;
+
+bool matrixFreeSolve( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & Ut, const arma::mat & elemKTe, unsigned int matrixVersion, \
+  const arma::vec & b, double relTol, linearSolverData & solver, arma::vec & x ) ;
+
+
+// --- solver.cpp ---
+void extractMethodParams( const arma::vec & numericalMethodParams, \
+  unsigned int & solutionMethod, double & stopTolDeltau, \
+  double & stopTolForces, unsigned int & stopTolIts, double & targetLoadFactr, \
+  unsigned int & nLoadSteps, double & incremArcLen, double & deltaT, \
+  double & deltaNW, double & AlphaNW, double & alphaHHT, double & finalTime ) ;
+
+void extractTangentPolicy( const arma::vec & numericalMethodParams, \
+  unsigned int & tangentPolicy, double & tangentParam ) ;
+
+void extractCppSolverParams( const arma::vec & cppSolverParams, \
+  unsigned int & assemblyStrategy, unsigned int & nAssemblyParts, \
+  unsigned int & batchedKernel, unsigned int & compactDofs, \
+  unsigned int & linearSolverMethod, unsigned int & preconditioner, \
+  double & linearRelTol, unsigned int & linearMaxIts, \
+  unsigned int & tangentOperator, unsigned int & nodeOrdering, \
+  unsigned int & symmetricStorage, unsigned int & loadSteps, \
+  unsigned int & outputInterval, unsigned int & tangentFiles, \
+  unsigned int & checkpointInterval, unsigned int & restart, \
+  unsigned int & resultsInterval, unsigned int & resultsStresses, \
+  unsigned int & verbosity, unsigned int & logFormat ) ;
+
+void computeFext( const modelData & model, double nextLoadFactor, \
+  arma::vec & FextG ) ;
+
+void computeRHSFromForces( const modelData & model, \
+  const arma::field<arma::vec> & fs, double nextLoadFactor, \
+  arma::vec & systemDeltauRHS, arma::vec & FextG ) ;
+
+void computeRHS( const modelData & model, const assemblyData & assembly, \
+  solverState & state ) ;
+
+void updateTime( const modelData & model, solverState & state ) ;
+
+void updateUiter( const arma::vec & deltaured, const arma::uvec & redDofs, \
+  unsigned int solutionMethod, arma::vec & Utp1k ) ;
+
+void computeForcingTerm( const modelData & model, unsigned int dispIter, \
+  solverState & state ) ;
+
+void solveTangentSystem( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & rhs, solverState & state, arma::vec & x ) ;
+
+void computeDeltaU( const modelData & model, const assemblyData & assembly, \
+  unsigned int dispIter, const arma::vec & currDeltau, solverState & state ) ;
+
+void computeMatrixFree( const modelData & model, const assemblyData & assembly, \
+  solverState & state ) ;
+
+void computeMatrix( const modelData & model, const assemblyData & assembly, \
+  solverState & state ) ;
+
+void computeRHSAndMatrix( const modelData & model, \
+  const assemblyData & assembly, solverState & state ) ;
+
+void computeIterationSystem( const modelData & model, \
+  const assemblyData & assembly, unsigned int dispIter, solverState & state ) ;
+
+void convergenceTest( const modelData & model, const solverState & state, \
+  unsigned int dispIters, bool & booleanConverged, \
+  unsigned int & stopCritPar, double & deltaErrLoad ) ;
+
+void printSolverOutput( solverLog & log, unsigned int timeIndex, \
+  const arma::vec & lineData ) ;
+
+void solverLogFlush( solverLog & log ) ;
+
+
+// --- dataFile.cpp ---
+void dataFileAddMat( dataFile & file, const std::string & name, const arma::mat & M ) ;
+
+void dataFileAddUmat( dataFile & file, const std::string & name, const arma::umat & M ) ;
+
+void dataFileAddSpMat( dataFile & file, const std::string & name, const arma::sp_mat & A ) ;
+
+void dataFileSave( const std::string & path, const dataFile & file ) ;
+
+bool dataFileOpen( const std::string & path, dataFile & file ) ;
+
+void dataFileClose( dataFile & file ) ;
+
+const dataFileSection * dataFileFind( const dataFile & file, const std::string & name ) ;
+
+arma::mat dataFileMat( const dataFile & file, const std::string & name ) ;
+
+arma::vec dataFileVec( const dataFile & file, const std::string & name ) ;
+
+arma::umat dataFileUmat( const dataFile & file, const std::string & name ) ;
+
+arma::sp_mat dataFileSpMat( const dataFile & file, const std::string & name ) ;
+
+
+// --- session.cpp ---
+void sessionSetup( const arma::imat & conec, const arma::mat & coordsElemsMat, \
+  const arma::uvec & neumdofs, const arma::vec & constantFext, \
+  const arma::vec & variableFext, const arma::vec & cppSolverParams, \
+  const std::string & checkpointPath, solverSession & session ) ;
+
+void sessionCheckpoint( const solverSession & session, const arma::vec & U, \
+  const arma::vec & Udot, const arma::vec & Udotdot, double currLoadFactor, \
+  double nextLoadFactor, double currTime, unsigned int timeIndex, \
+  const std::string & path, sessionCheckpointData & checkpoint ) ;
+
+void sessionCheckpointWait( sessionCheckpointData & checkpoint ) ;
+
+void sessionRestoreSetup( const dataFile & checkpoint, unsigned int nodeOrdering, \
+  bool halfStored, solverSession & session ) ;
+
+bool sessionRestoreState( solverSession & session, arma::vec & U, arma::vec & Udot, \
+  arma::vec & Udotdot, double & currLoadFactor, double & nextLoadFactor, \
+  double & currTime, unsigned int & timeIndex ) ;
+
+void sessionSetTangent( const arma::sp_mat & onsasMatrix, solverSession & session ) ;
+
+void sessionTangent( const solverSession & session, arma::sp_mat & onsasMatrix ) ;
+
+void sessionTimeStep( const arma::vec & U, const arma::vec & Udot, \
+  const arma::vec & Udotdot, double currLoadFactor, double nextLoadFactor, \
+  double currTime, unsigned int timeIndex, solverSession & session, \
+  arma::vec & Ut, arma::vec & Utp1, arma::vec & Udottp1, arma::vec & Udotdottp1, \
+  arma::vec & auxOutValsVec ) ;
+
+
+// --- resultsWriter.cpp ---
+void resultsWriterOpen( const modelData & model, const std::string & path, \
+  bool stresses, resultsWriter & results ) ;
+
+void resultsWriterPush( const modelData & model, const assemblyData & assembly, \
+  const arma::vec & U, double time, resultsWriter & results ) ;
+
+void resultsWriterClose( resultsWriter & results ) ;
+
+#endif
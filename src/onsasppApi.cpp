@@ -0,0 +1,191 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// C interface of the solver sessions, see onsasppApi.h. The errors of
+// Armadillo (exceptions) are caught here and returned as status codes.
+
+#include "onsaspp.h"
+#include "onsasppApi.h"
+
+#include <exception>
+#include <string>
+
+using namespace std  ;
+using namespace arma ;
+
+struct onsasppSession {
+  solverSession session ;
+};
+
+static thread_local string lastError ;
+
+// dense matrix of the interface, copied
+static mat toMat( const onsasppMatrix & m ){
+  if ( m.values == nullptr || m.nRows*m.nCols == 0 ){ return mat() ; }
+  return mat( m.values, m.nRows, m.nCols ) ;
+}
+
+static vec toVec( const onsasppMatrix & m ){
+  if ( m.values == nullptr || m.nRows*m.nCols == 0 ){ return vec() ; }
+  return vec( m.values, m.nRows*m.nCols ) ;
+}
+
+// =============================================================================
+onsasppSession * onsasppCreate( const onsasppModelInputs * inputs ){
+
+  onsasppSession * handle = nullptr ;
+  try {
+    handle = new onsasppSession ;
+    solverSession & session = handle->session ;
+    modelData & model = session.model ;
+
+    model.materialsParamsMat    = toMat( inputs->materialsParamsMat ) ;
+    model.elementsParamsMat     = toMat( inputs->elementsParamsMat  ) ;
+    model.numericalMethodParams = toVec( inputs->numericalMethodParams ) ;
+    model.nodalDispDamping      = inputs->nodalDispDamping ;
+    if ( inputs->outputDir   != nullptr ){ session.outputDir   = inputs->outputDir   ; }
+    if ( inputs->problemName != nullptr ){ session.problemName = inputs->problemName ; }
+
+    imat conec = conv_to<imat>::from( toMat( inputs->conec ) ) ;
+    uvec neumdofs = conv_to<uvec>::from( toVec( inputs->neumdofs ) ) ;
+    sessionSetup( conec, toMat( inputs->coordsElemsMat ), neumdofs, \
+      toVec( inputs->constantFext ), toVec( inputs->variableFext ), \
+      toVec( inputs->cppSolverParams ), "", session ) ;
+    return handle ;
+  } catch ( const exception & e ) {
+    lastError = e.what() ;
+    delete handle ;
+    return nullptr ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+void onsasppDestroy( onsasppSession * session ){
+  if ( session != nullptr ){ solverLogFlush( session->session.log ) ; }
+  delete session ;
+}
+// =============================================================================
+
+
+// =============================================================================
+size_t onsasppNumDofs( const onsasppSession * session ){
+  return 6 * (size_t) session->session.model.nNodes ;
+}
+// =============================================================================
+
+
+// =============================================================================
+size_t onsasppNumFreeDofs( const onsasppSession * session ){
+  return session->session.model.neumdofs.n_elem ;
+}
+// =============================================================================
+
+
+// =============================================================================
+int onsasppSetTangent( onsasppSession * session, size_t n, const size_t * colPtrs, \
+  const size_t * rowInds, const double * values ){
+
+  try {
+    uword nnz = colPtrs[ n ] ;
+    uvec colPtrsVec( n+1 ), rowIndsVec( nnz ) ;
+    vec  valuesVec( nnz ) ;
+    for ( uword i=0; i <= n; i++){ colPtrsVec( i ) = colPtrs[ i ] ; }
+    for ( uword p=0; p < nnz; p++){ rowIndsVec( p ) = rowInds[ p ] ;  valuesVec( p ) = values[ p ] ; }
+    sessionSetTangent( sp_mat( rowIndsVec, colPtrsVec, valuesVec, n, n ), session->session ) ;
+    return 0 ;
+  } catch ( const exception & e ) {
+    lastError = e.what() ;
+    return -1 ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+int onsasppTimeStep( onsasppSession * session, const double * U, \
+  const double * Udot, const double * Udotdot, double currLoadFactor, \
+  double nextLoadFactor, double currTime, unsigned int timeIndex, double * Ut, \
+  double * Utp1, double * Udottp1, double * Udotdottp1, double * auxOutVals ){
+
+  try {
+    uword nDofs = onsasppNumDofs( session ) ;
+    vec UVec( U, nDofs ), UdotVec, UdotdotVec ;
+    if ( Udot    != nullptr ){ UdotVec    = vec( Udot   , nDofs ) ; }
+    if ( Udotdot != nullptr ){ UdotdotVec = vec( Udotdot, nDofs ) ; }
+
+    vec UtVec, Utp1Vec, Udottp1Vec, Udotdottp1Vec, auxOutValsVec ;
+    sessionTimeStep( UVec, UdotVec, UdotdotVec, currLoadFactor, nextLoadFactor, \
+      currTime, timeIndex, session->session, UtVec, Utp1Vec, Udottp1Vec, \
+      Udotdottp1Vec, auxOutValsVec ) ;
+
+    std::copy( UtVec.begin()        , UtVec.end()        , Ut         ) ;
+    std::copy( Utp1Vec.begin()      , Utp1Vec.end()      , Utp1       ) ;
+    std::copy( Udottp1Vec.begin()   , Udottp1Vec.end()   , Udottp1    ) ;
+    std::copy( Udotdottp1Vec.begin(), Udotdottp1Vec.end(), Udotdottp1 ) ;
+    std::copy( auxOutValsVec.begin(), auxOutValsVec.end(), auxOutVals ) ;
+    return 0 ;
+  } catch ( const exception & e ) {
+    lastError = e.what() ;
+    return -1 ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+size_t onsasppTangentNnz( const onsasppSession * session ){
+
+  try {
+    sp_mat tangent ;
+    sessionTangent( session->session, tangent ) ;
+    return tangent.n_nonzero ;
+  } catch ( const exception & e ) {
+    lastError = e.what() ;
+    return 0 ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+int onsasppTangent( const onsasppSession * session, size_t * colPtrs, \
+  size_t * rowInds, double * values ){
+
+  try {
+    sp_mat tangent ;
+    sessionTangent( session->session, tangent ) ;
+    uword n = onsasppNumFreeDofs( session ) ;
+    for ( uword i=0; i <= n; i++){ colPtrs[ i ] = ( i <= tangent.n_cols ) ? tangent.col_ptrs[ i ] : 0 ; }
+    for ( uword p=0; p < tangent.n_nonzero; p++){
+      rowInds[ p ] = tangent.row_indices[ p ] ;  values[ p ] = tangent.values[ p ] ;
+    }
+    return 0 ;
+  } catch ( const exception & e ) {
+    lastError = e.what() ;
+    return -1 ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+const char * onsasppLastError( void ){
+  return lastError.c_str() ;
+}
+// =============================================================================
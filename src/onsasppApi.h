@@ -0,0 +1,97 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// C interface of libonsaspp. A session keeps the model, the assembly data and
+// the solver state, with the factorization of the tangent matrix, for all
+// the time steps of an analysis, so that ONSAS (or the MEX wrapper in ../mex)
+// solves each step with a function call instead of writing the input files
+// and running timeStepIteration.lnx. The arguments are those of the files
+// read by timeStepIteration.lnx: dense matrices in column major order (as
+// Octave and MATLAB), vectors in the ONSAS numbering (6 dofs per node) and
+// the reduced tangent matrix in compressed columns with 0-based indices.
+// The functions returning int return 0 on success and -1 on error, with the
+// message given by onsasppLastError.
+
+#ifndef ONSASPP_API_H
+#define ONSASPP_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct onsasppSession onsasppSession ;
+
+// dense matrix, column major, nRows x nCols
+typedef struct {
+  const double * values ;
+  size_t nRows, nCols ;
+} onsasppMatrix ;
+
+// inputs of the model, copied by onsasppCreate. cppSolverParams may be
+// empty and outputDir and problemName NULL.
+typedef struct {
+  onsasppMatrix conec, coordsElemsMat, materialsParamsMat, elementsParamsMat ;
+  onsasppMatrix numericalMethodParams, neumdofs, constantFext, variableFext ;
+  onsasppMatrix cppSolverParams ;
+  double nodalDispDamping ;
+  const char * outputDir, * problemName ;
+} onsasppModelInputs ;
+
+// session of the model, NULL on error
+onsasppSession * onsasppCreate( const onsasppModelInputs * inputs ) ;
+
+// writes the increments log records not yet written and frees the session
+void onsasppDestroy( onsasppSession * session ) ;
+
+// number of dofs of the ONSAS vectors, 6 per node
+size_t onsasppNumDofs( const onsasppSession * session ) ;
+
+// number of free dofs, order of the reduced tangent matrix
+size_t onsasppNumFreeDofs( const onsasppSession * session ) ;
+
+// reduced tangent matrix of order n used by the first iteration of the next
+// time step, instead of the one kept from the previous step
+int onsasppSetTangent( onsasppSession * session, size_t n, const size_t * colPtrs, \
+  const size_t * rowInds, const double * values ) ;
+
+// one time step from the converged values at currTime. Udot and Udotdot may
+// be NULL for zero. Ut, Utp1, Udottp1 and Udotdottp1 have onsasppNumDofs
+// entries and auxOutVals 4: next time, stop criterion, iterations and
+// solution method.
+int onsasppTimeStep( onsasppSession * session, const double * U, \
+  const double * Udot, const double * Udotdot, double currLoadFactor, \
+  double nextLoadFactor, double currTime, unsigned int timeIndex, double * Ut, \
+  double * Utp1, double * Udottp1, double * Udotdottp1, double * auxOutVals ) ;
+
+// last reduced tangent matrix: its number of nonzeros, and its entries with
+// colPtrs of onsasppNumFreeDofs+1 entries and rowInds and values of
+// onsasppTangentNnz entries. Empty for the matrix-free tangent operators.
+size_t onsasppTangentNnz( const onsasppSession * session ) ;
+
+int onsasppTangent( const onsasppSession * session, size_t * colPtrs, \
+  size_t * rowInds, double * values ) ;
+
+// message of the last error of the calling thread
+const char * onsasppLastError( void ) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,317 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// results of the time steps of a run, for ParaView and other XDMF readers:
+// the heavy data are appended to the raw binary file <path>.raw and the file
+// <path>.xdmf describes them, rewritten (and renamed, so that it is always
+// complete) after each step written. Layout of <path>.raw, native byte order:
+//
+//   geometry   : reference coordinates of the nodes, nNodes x 3 doubles
+//   topology   : nodes of the tetrahedra, nCells x 4 int64 (0-based)
+//   elements   : ONSAS element (1-based) of each cell, nCells int64
+//   each step  : displacements of the nodes, nNodes x 3 doubles, and with the
+//                stresses option the second Piola-Kirchhoff stress of the
+//                cells, nCells x 6 doubles ( xx xy xz yy yz zz ), zero for
+//                the cells of materials other than Saint-Venant-Kirchhoff
+//
+// The nodes are in the ONSAS numbering. The steps are written by a thread
+// from two buffers: resultsWriterPush fills one while the other is written,
+// and waits only if both are being written. An error of the thread stops the
+// writing, and is thrown by the next resultsWriterPush or resultsWriterClose.
+
+#include "onsaspp.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+static string byteOrder(){
+  const uint32_t one = 1 ;
+  return *reinterpret_cast<const unsigned char *>( &one ) == 1 ? "Little" : "Big" ;
+}
+
+static string dataItem( uword nRows, uword nCols, const string & numberType, \
+  uword seek, const string & rawName ){
+  return "<DataItem Dimensions=\"" + to_string( nRows ) + " " + to_string( nCols ) \
+    + "\" NumberType=\"" + numberType + "\" Precision=\"8\" Format=\"Binary\" Endian=\"" \
+    + byteOrder() + "\" Seek=\"" + to_string( seek ) + "\">" + rawName + "</DataItem>" ;
+}
+
+static void writeRaw( FILE * file, const void * data, size_t bytes, resultsWriter & results ){
+  if ( bytes > 0 && fwrite( data, 1, bytes, file ) != bytes ){
+    throw runtime_error( "resultsWriter: can not write " + results.rawPath ) ;
+  }
+  results.rawBytes += bytes ;
+}
+
+// temporal collection of the steps written, each one a grid with the mesh
+static void writeXdmf( const resultsWriter & results ){
+  string tmpPath = results.xdmfPath + ".tmp" ;
+  FILE * file = fopen( tmpPath.c_str(), "w" ) ;
+  if ( file == nullptr ){ throw runtime_error( "resultsWriter: can not write " + tmpPath ) ; }
+
+  const string & raw = results.rawName ;
+  fprintf( file, "<?xml version=\"1.0\" ?>\n<Xdmf Version=\"3.0\">\n  <Domain>\n" ) ;
+  fprintf( file, "    <Grid Name=\"steps\" GridType=\"Collection\" CollectionType=\"Temporal\">\n" ) ;
+  for ( size_t k=0; k < results.times.size(); k++){
+    uword seek = results.stepSeeks[ k ] ;
+    fprintf( file, "      <Grid Name=\"step%zu\" GridType=\"Uniform\">\n", k+1 ) ;
+    fprintf( file, "        <Time Value=\"%.17g\" />\n", results.times[ k ] ) ;
+    fprintf( file, "        <Topology TopologyType=\"Tetrahedron\" NumberOfElements=\"%llu\">\n" \
+      "          %s\n        </Topology>\n", (unsigned long long) results.nCells, \
+      dataItem( results.nCells, 4, "Int", results.topologySeek, raw ).c_str() ) ;
+    fprintf( file, "        <Geometry GeometryType=\"XYZ\">\n          %s\n        </Geometry>\n", \
+      dataItem( results.nNodes, 3, "Float", results.geometrySeek, raw ).c_str() ) ;
+    fprintf( file, "        <Attribute Name=\"element\" AttributeType=\"Scalar\" Center=\"Cell\">\n" \
+      "          %s\n        </Attribute>\n", \
+      dataItem( results.nCells, 1, "Int", results.elementsSeek, raw ).c_str() ) ;
+    fprintf( file, "        <Attribute Name=\"displacements\" AttributeType=\"Vector\" Center=\"Node\">\n" \
+      "          %s\n        </Attribute>\n", \
+      dataItem( results.nNodes, 3, "Float", seek, raw ).c_str() ) ;
+    if ( results.stresses ){
+      fprintf( file, "        <Attribute Name=\"stressPK2\" AttributeType=\"Tensor6\" Center=\"Cell\">\n" \
+        "          %s\n        </Attribute>\n", dataItem( results.nCells, 6, "Float", \
+        seek + 3*results.nNodes*sizeof( double ), raw ).c_str() ) ;
+    }
+    fprintf( file, "      </Grid>\n" ) ;
+  }
+  fprintf( file, "    </Grid>\n  </Domain>\n</Xdmf>\n" ) ;
+
+  bool failed = ferror( file ) != 0 ;
+  if ( fclose( file ) != 0 || failed ){
+    throw runtime_error( "resultsWriter: can not write " + tmpPath ) ;
+  }
+  if ( rename( tmpPath.c_str(), results.xdmfPath.c_str() ) != 0 ){
+    throw runtime_error( "resultsWriter: can not rename " + tmpPath ) ;
+  }
+}
+
+// thread of the writer: appends the queued buffers to the raw file, in order,
+// and frees them. After an error, kept for resultsWriterPush and
+// resultsWriterClose, the buffers are freed without being written.
+static void writerLoop( resultsWriter & results ){
+  FILE * file = fopen( results.rawPath.c_str(), "ab" ) ;
+
+  unique_lock<mutex> lock( results.mutex ) ;
+  if ( file == nullptr ){ results.error = "resultsWriter: can not open " + results.rawPath ; }
+  while ( true ){
+    results.changed.wait( lock, [ &results ](){ return !results.queue.empty() || results.stop ; } ) ;
+    if ( results.queue.empty() ){ break ; }
+    unsigned int b = results.queue.front() ;
+    bool failed = !results.error.empty() ;
+    lock.unlock() ;
+
+    string error ;
+    if ( !failed ){
+      try {
+        uword seek = results.rawBytes ;
+        writeRaw( file, results.buffers[ b ].memptr(), \
+          results.buffers[ b ].n_elem * sizeof( double ), results ) ;
+        fflush( file ) ;
+        results.times.push_back( results.bufferTimes[ b ] ) ;
+        results.stepSeeks.push_back( seek ) ;
+        writeXdmf( results ) ;
+      } catch ( const exception & e ) {
+        error = e.what() ;
+      }
+    }
+
+    lock.lock() ;
+    if ( !error.empty() ){ results.error = error ; }
+    results.queue.pop_front() ;
+    results.busy[ b ] = false ;
+    results.changed.notify_all() ;
+  }
+  if ( file != nullptr ){ fclose( file ) ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- resultsWriterOpen ---
+// =============================================================================
+// writes the mesh of model (the reference coordinates and the tetrahedra) to
+// the new files <path>.raw and <path>.xdmf, without steps, and starts the
+// writer thread. With stresses the steps also have the element stresses.
+void resultsWriterOpen( const modelData & model, const string & path, \
+  bool stresses, resultsWriter & results ){
+
+  results.xdmfPath = path + ".xdmf" ;
+  results.rawPath  = path + ".raw"  ;
+  results.rawName  = results.rawPath.substr( results.rawPath.find_last_of( '/' ) + 1 ) ;
+  results.stresses = stresses ;
+  results.nNodes   = model.nNodes ;
+  results.rawBytes = 0 ;
+  results.times.clear() ;  results.stepSeeks.clear() ;
+
+  // cells: the tetrahedra, group by group as the assembler computes them
+  uword nCells = 0 ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    if ( model.groupType( group ) == 4 ){ nCells += model.groupPtrs( group+1 ) - model.groupPtrs( group ) ; }
+  }
+  results.nCells = nCells ;
+  results.cellElems.set_size( nCells ) ;
+  uword cell = 0 ;
+  for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+    if ( model.groupType( group ) != 4 ){ continue ; }
+    for ( uword k=model.groupPtrs( group ); k < model.groupPtrs( group+1 ); k++){
+      results.cellElems( cell++ ) = model.groupElems( k ) ;
+    }
+  }
+
+  // mesh, in the ONSAS numbering of the nodes
+  vector<double>  geometry( 3*model.nNodes ) ;
+  vector<int64_t> topology( 4*nCells ), elements( nCells ) ;
+  for ( uword node=0; node < model.nNodes; node++){
+    uword onsasNode = model.nodePerm.is_empty() ? node : model.nodePerm( node ) ;
+    geometry[ 3*onsasNode     ] = model.nodeCoordsX( node ) ;
+    geometry[ 3*onsasNode + 1 ] = model.nodeCoordsY( node ) ;
+    geometry[ 3*onsasNode + 2 ] = model.nodeCoordsZ( node ) ;
+  }
+  for ( uword c=0; c < nCells; c++){
+    uword elem = results.cellElems( c ) ;
+    for ( int ind=0; ind < 4; ind++){
+      uword node = model.elemNodes( 4*elem + ind ) ;
+      topology[ 4*c + ind ] = model.nodePerm.is_empty() ? node : model.nodePerm( node ) ;
+    }
+    elements[ c ] = ( model.elemPerm.is_empty() ? elem : model.elemPerm( elem ) ) + 1 ;
+  }
+
+  FILE * file = fopen( results.rawPath.c_str(), "wb" ) ;
+  if ( file == nullptr ){ throw runtime_error( "resultsWriter: can not write " + results.rawPath ) ; }
+  results.geometrySeek = results.rawBytes ;
+  writeRaw( file, geometry.data(), geometry.size() * sizeof( double  ), results ) ;
+  results.topologySeek = results.rawBytes ;
+  writeRaw( file, topology.data(), topology.size() * sizeof( int64_t ), results ) ;
+  results.elementsSeek = results.rawBytes ;
+  writeRaw( file, elements.data(), elements.size() * sizeof( int64_t ), results ) ;
+  fclose( file ) ;
+  writeXdmf( results ) ;
+
+  uword nValues = 3*model.nNodes + ( stresses ? 6*nCells : 0 ) ;
+  for ( int b=0; b < 2; b++){ results.buffers[ b ].set_size( nValues ) ;  results.busy[ b ] = false ; }
+  results.next = 0 ;  results.queue.clear() ;  results.stop = false ;  results.error.clear() ;
+
+  results.writer = thread( writerLoop, ref( results ) ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- resultsWriterPush ---
+// =============================================================================
+// copies the displacements U (ONSAS numbering) at time and, with the stresses
+// option, computes the stresses of the cells to the free buffer, and queues
+// it for the writer thread. The stresses are computed for the Saint-Venant-
+// Kirchhoff materials only, the cells of other materials get zero stresses.
+// Throws the error of the writer thread, if any: the thread is then stopped
+// and the steps not yet written are lost.
+void resultsWriterPush( const modelData & model, const assemblyData & assembly, \
+  const vec & U, double time, resultsWriter & results ){
+
+  unsigned int b = results.next ;
+  {
+    unique_lock<mutex> lock( results.mutex ) ;
+    results.changed.wait( lock, [ &results, b ](){ return !results.busy[ b ] ; } ) ;
+    if ( !results.error.empty() ){
+      lock.unlock() ;
+      resultsWriterClose( results ) ;
+    }
+  }
+  double * values = results.buffers[ b ].memptr() ;
+
+  for ( uword node=0; node < results.nNodes; node++){
+    values[ 3*node     ] = U( 6*node     ) ;
+    values[ 3*node + 1 ] = U( 6*node + 2 ) ;
+    values[ 3*node + 2 ] = U( 6*node + 4 ) ;
+  }
+
+  if ( results.stresses ){
+    double * stress = values + 3*results.nNodes ;
+    vec Umodel ;
+    dofsOnsasToModel( model, U, Umodel ) ;
+
+    uword cell = 0 ;
+    for ( uword group=0; group+1 < model.groupPtrs.n_elem; group++){
+      if ( model.groupType( group ) != 4 ){ continue ; }
+      int    materialRow = model.groupMaterial( group ) ;
+      bool   svk   = model.materialsParamsMat( materialRow, 2-1 ) == 2 ;
+      double young = model.materialsParamsMat( materialRow, 3-1 ) ;
+      double nu    = model.materialsParamsMat( materialRow, 4-1 ) ;
+
+      uword nGroupCells = model.groupPtrs( group+1 ) - model.groupPtrs( group ) ;
+      #pragma omp parallel for
+      for ( uword k=0; k < nGroupCells; k++){
+        uword elem = results.cellElems( cell + k ) ;
+        double * S = stress + 6*( cell + k ) ;
+        if ( !svk ){ for ( int i=0; i < 6; i++){ S[ i ] = 0 ; }  continue ; }
+
+        uword  dofselem [ 4*6/2 ] ;
+        double elemDisps[ 4*6/2 ], Svoigt[ 6 ] ;
+        tetraDofs( model, elem, dofselem ) ;
+        for ( int ind=0; ind < 12; ind++){ elemDisps[ ind ] = Umodel( dofselem[ ind ] - 1 ) ; }
+        elementTetraSVKStress( assembly.elemFunders.colptr( elem ), elemDisps, young, nu, Svoigt ) ;
+
+        // Voigt order to the order of the XDMF Tensor6 attributes
+        S[0] = Svoigt[0] ;  S[1] = Svoigt[5] ;  S[2] = Svoigt[4] ;
+        S[3] = Svoigt[1] ;  S[4] = Svoigt[3] ;  S[5] = Svoigt[2] ;
+      }
+      cell += nGroupCells ;
+    }
+  }
+
+  lock_guard<mutex> lock( results.mutex ) ;
+  results.bufferTimes[ b ] = time ;
+  results.busy[ b ] = true ;
+  results.queue.push_back( b ) ;
+  results.next = 1 - b ;
+  results.changed.notify_all() ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- resultsWriterClose ---
+// =============================================================================
+// waits for the steps queued to be written and stops the writer thread.
+// Throws the error of the thread, if any, once.
+void resultsWriterClose( resultsWriter & results ){
+  if ( results.writer.joinable() ){
+    {
+      lock_guard<mutex> lock( results.mutex ) ;
+      results.stop = true ;
+      results.changed.notify_all() ;
+    }
+    results.writer.join() ;
+  }
+  if ( !results.error.empty() ){
+    string error = results.error ;
+    results.error.clear() ;
+    throw runtime_error( error ) ;
+  }
+}
+// =============================================================================
@@ -0,0 +1,507 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// solver session: the model, the assembly data and the solver state, with
+// the factorization, built once and kept for all the time steps solved in
+// the same process (see onsasppApi.h and the timeStepIteration driver).
+
+#include "onsaspp.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- sessionSetup ---
+// =============================================================================
+// model store, reference geometry, symbolic analysis of the reduced tangent
+// matrix and parallel assembly schedule, computed once. The ONSAS matrices
+// materialsParamsMat, elementsParamsMat and numericalMethodParams, and
+// nodalDispDamping, are set in session.model by the caller. neumdofs,
+// constantFext and variableFext are in the ONSAS numbering (6 dofs per
+// node); cppSolverParams may be empty (see extractCppSolverParams). With the
+// restart option, if the file checkpointPath exists, the node ordering,
+// geometry, pattern, schedule and LDL' analysis of its checkpoint (see
+// sessionCheckpoint) are used instead of computing them, and the file is
+// kept for sessionRestoreState.
+void sessionSetup( const imat & conec, const mat & coordsElemsMat, \
+  const uvec & neumdofs, const vec & constantFext, const vec & variableFext, \
+  const vec & cppSolverParams, const string & checkpointPath, solverSession & session ){
+
+  modelData    & model    = session.model    ;
+  assemblyData & assembly = session.assembly ;
+  solverState  & state    = session.state    ;
+
+  uint compactDofs, nodeOrdering, symmetricStorage ;
+  extractCppSolverParams( cppSolverParams, assembly.strategy, assembly.nParts, \
+                          assembly.batchedKernel, compactDofs, \
+                          state.linearSolver.method, state.linearSolver.preconditioner, \
+                          state.linearSolver.relTol, state.linearSolver.maxIts, \
+                          assembly.tangentOperator, nodeOrdering, symmetricStorage, \
+                          session.loadSteps, session.outputInterval, session.tangentFiles, \
+                          session.checkpointInterval, session.restart, \
+                          session.resultsInterval, session.resultsStresses, \
+                          session.log.verbosity, session.log.format ) ;
+
+  // increments log, of the named problems
+  session.log.path.clear() ;
+  if ( session.log.format > 0 && !session.problemName.empty() ){
+    session.log.path = session.outputDir + session.problemName + "_incrementsOutput" \
+      + ( session.log.format == 1 ? ".csv" : ".jsonl" ) ;
+  }
+
+  const dataFile * checkpoint = nullptr ;
+  if ( session.restart && !checkpointPath.empty() \
+       && dataFileOpen( checkpointPath, session.restartFile ) ){
+    checkpoint = &session.restartFile ;
+  }
+
+  computeModelData( conec, coordsElemsMat, model.elementsParamsMat, \
+    constantFext.n_elem / 6, model ) ;
+
+  // renumbering of the nodes and elements, with the statistics of the nodes
+  // graph in the ONSAS and the new numbering. The fill reducing orderings
+  // are also used by the LDL' factorization.
+  if ( checkpoint != nullptr ){
+    uvec nodePerm = dataFileUmat( *checkpoint, "nodePerm" ) ;
+    if ( nodePerm.n_elem > 0 && nodePerm.n_elem != model.nNodes ){
+      throw runtime_error( "sessionSetup: the checkpoint is of another model or settings" ) ;
+    }
+    if ( nodePerm.n_elem > 0 ){ permuteModelNodes( model, nodePerm ) ; }
+    state.linearSolver.naturalOrder = nodeOrdering >= 2 ;
+  }else if ( nodeOrdering > 0 ){
+    uword bandwidth0, profile0, factorNnz0, bandwidth, profile, factorNnz ;
+    nodeOrderingStats( model, bandwidth0, profile0, factorNnz0 ) ;
+    renumberModel( model, nodeOrdering ) ;
+    nodeOrderingStats( model, bandwidth, profile, factorNnz ) ;
+    if ( session.log.verbosity >= 1 ){
+      cout << "node ordering " << nodeOrdering << " | bandwidth: " << bandwidth0 << " -> " \
+        << bandwidth << " | profile: " << profile0 << " -> " << profile \
+        << " | nnz(L) of the nodes graph: " << factorNnz0 << " -> " << factorNnz << '\n' ;
+    }
+    state.linearSolver.naturalOrder = nodeOrdering >= 2 ;
+  }
+
+  // model dofs numbering and global to reduced dofs map. The ONSAS vectors
+  // are translated here and back when the results are returned.
+  computeDofsNumbering( neumdofs, compactDofs, model ) ;
+  dofsOnsasToModel( model, constantFext, model.constantFext ) ;
+  dofsOnsasToModel( model, variableFext, model.variableFext ) ;
+
+  // symmetric tangent matrices of the LDL' solver, assembled and stored with
+  // the entries of the upper triangle in its ordering, which are the ones it
+  // reads
+  bool halfStored = symmetricStorage && state.linearSolver.method == 1 \
+    && assembly.tangentOperator == 0 && symmetricTangent( model ) ;
+
+  if ( checkpoint != nullptr ){
+    sessionRestoreSetup( *checkpoint, nodeOrdering, halfStored, session ) ;
+    return ;
+  }
+
+  computeElemGeometry( model, assembly.elemFunders, assembly.elemVols ) ;
+
+  // the matrix-free tangent operator does not use the pattern of the
+  // assembled matrix
+  if ( assembly.tangentOperator == 0 ){
+    computeSparsityPattern( model, model.dofsMap, model.neumdofs.n_elem, \
+      assembly.colPtrs, assembly.rowInds, assembly.elemSlots ) ;
+  }
+
+  if ( assembly.strategy == 1 || assembly.tangentOperator > 0 ){
+    computeElemColors( model, assembly.colorPtrs, assembly.colorElems, \
+      assembly.colorGroups ) ;
+  }
+
+  // ordering and symbolic factorization of the tangent matrix, or data of the
+  // preconditioners, used by all the iterations
+  if ( state.linearSolver.method > 0 ){
+    linearSolverSetup( model, assembly, state.linearSolver ) ;
+  }
+
+  // the analysed pattern is also halved with the symmetric storage
+  if ( halfStored ){
+    linearSolverData & solver = state.linearSolver ;
+    computeHalfPattern( solver.permInv, assembly.colPtrs, assembly.rowInds, assembly.elemSlots ) ;
+    solver.colPtrs = assembly.colPtrs ;  solver.rowInds = assembly.rowInds ;
+    solver.halfStored = true ;
+  }
+
+  // ranges of the forces and values written by the element parts of the
+  // partial buffers strategy, which size their buffers
+  if ( assembly.strategy == 2 ){
+    computePartRanges( model, assembly ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionCheckpoint ---
+// =============================================================================
+// writes the converged values U, Udot and Udotdot (ONSAS numbering) at time
+// currTime, from which the step timeIndex starts, with the last tangent
+// matrix and the data computed by sessionSetup, to the binary container path
+// (see dataFile.cpp). The state is copied and the file is written by a
+// thread, to path.tmp and then renamed, so that the step is solved meanwhile
+// and path always has a complete checkpoint. Waits for the previous one.
+void sessionCheckpoint( const solverSession & session, const vec & U, \
+  const vec & Udot, const vec & Udotdot, double currLoadFactor, \
+  double nextLoadFactor, double currTime, uint timeIndex, const string & path, \
+  sessionCheckpointData & checkpoint ){
+
+  sessionCheckpointWait( checkpoint ) ;
+
+  const modelData        & model    = session.model    ;
+  const assemblyData     & assembly = session.assembly ;
+  const linearSolverData & solver   = session.state.linearSolver ;
+
+  // model and settings the checkpoint is valid for, and values of the step
+  checkpoint.setup = { double( model.nNodes ), double( model.nElems ), \
+    double( model.redDofs.n_elem ), double( model.dofsPerNode ), \
+    double( assembly.strategy ), double( assembly.nParts ), \
+    double( assembly.tangentOperator ), double( solver.method ), \
+    double( solver.halfStored ), double( solver.analysed ) } ;
+  checkpoint.step = { currLoadFactor, nextLoadFactor, currTime, double( timeIndex ) } ;
+  checkpoint.U = U ;  checkpoint.Udot = Udot ;  checkpoint.Udotdot = Udotdot ;
+  checkpoint.tangent = session.state.systemDeltauMatrix ;
+
+  // the analysis may change with the matrix (see linearSolverFactorize)
+  checkpoint.ldlPerm   = solver.perm      ;
+  checkpoint.ldlBlocks = solver.dofBlocks ;
+  checkpoint.ldlLp     = solver.Lp        ;
+  checkpoint.ldlParent = conv_to<vec>::from( solver.parent ) ;
+  checkpoint.elemSlots = conv_to<umat>::from( assembly.elemSlots ) ;
+
+  dataFile & file = checkpoint.file ;
+  file.sections.clear() ;
+  dataFileAddMat ( file, "setup"  , checkpoint.setup   ) ;
+  dataFileAddMat ( file, "step"   , checkpoint.step    ) ;
+  dataFileAddMat ( file, "U"      , checkpoint.U       ) ;
+  dataFileAddMat ( file, "Udot"   , checkpoint.Udot    ) ;
+  dataFileAddMat ( file, "Udotdot", checkpoint.Udotdot ) ;
+  dataFileAddSpMat( file, "tangent", checkpoint.tangent ) ;
+
+  // data of the setup, not changed by the steps
+  dataFileAddUmat( file, "nodePerm"   , model.nodePerm       ) ;
+  dataFileAddMat ( file, "elemFunders", assembly.elemFunders ) ;
+  dataFileAddMat ( file, "elemVols"   , assembly.elemVols    ) ;
+  dataFileAddUmat( file, "colPtrs"    , assembly.colPtrs     ) ;
+  dataFileAddUmat( file, "rowInds"    , assembly.rowInds     ) ;
+  dataFileAddUmat( file, "elemSlots"  , checkpoint.elemSlots ) ;
+  dataFileAddUmat( file, "colorPtrs"  , assembly.colorPtrs   ) ;
+  dataFileAddUmat( file, "colorElems" , assembly.colorElems  ) ;
+  dataFileAddUmat( file, "colorGroups", assembly.colorGroups ) ;
+  dataFileAddUmat( file, "partRanges" , assembly.partRanges  ) ;
+  dataFileAddUmat( file, "ldlPerm"    , checkpoint.ldlPerm   ) ;
+  dataFileAddUmat( file, "ldlBlocks"  , checkpoint.ldlBlocks ) ;
+  dataFileAddUmat( file, "ldlLp"      , checkpoint.ldlLp     ) ;
+  dataFileAddMat ( file, "ldlParent"  , checkpoint.ldlParent ) ;
+
+  checkpoint.writer = thread( [ &file, path ](){
+    try {
+      dataFileSave( path + ".tmp", file ) ;
+      if ( rename( ( path + ".tmp" ).c_str(), path.c_str() ) != 0 ){
+        cout << "sessionCheckpoint: can not rename " << path << ".tmp" << endl ;
+      }
+    } catch ( const exception & e ) {
+      cout << e.what() << endl ;
+    }
+  } ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionCheckpointWait ---
+// =============================================================================
+// waits for the checkpoint being written, if any
+void sessionCheckpointWait( sessionCheckpointData & checkpoint ){
+  if ( checkpoint.writer.joinable() ){ checkpoint.writer.join() ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// copies of the sections of a checkpoint: the matrices of dataFileMat and
+// dataFileUmat use the mapped file, which is closed by sessionRestoreState,
+// and would keep using it when moved to the session
+static mat checkpointMat( const dataFile & checkpoint, const string & name ){
+  mat M = dataFileMat( checkpoint, name ) ;
+  return mat( M.memptr(), M.n_rows, M.n_cols ) ;
+}
+
+static umat checkpointUmat( const dataFile & checkpoint, const string & name ){
+  umat M = dataFileUmat( checkpoint, name ) ;
+  return umat( M.memptr(), M.n_rows, M.n_cols ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionRestoreSetup ---
+// =============================================================================
+// the part of sessionSetup after the dofs numbering, from a checkpoint: the
+// geometry, the pattern, the elements schedule and the LDL' analysis, copied
+// from the mapped file. halfStored is the storage of the tangent matrix set
+// by sessionSetup. Throws if the checkpoint is of another model or settings.
+void sessionRestoreSetup( const dataFile & checkpoint, uint nodeOrdering, \
+  bool halfStored, solverSession & session ){
+
+  modelData    & model    = session.model    ;
+  assemblyData & assembly = session.assembly ;
+  linearSolverData & solver = session.state.linearSolver ;
+
+  vec setup = dataFileVec( checkpoint, "setup" ) ;
+  const dataFileSection * nodePerm = dataFileFind( checkpoint, "nodePerm" ) ;
+  if ( setup.n_elem < 10 || nodePerm == nullptr || setup(0) != model.nNodes || setup(1) != model.nElems \
+       || setup(2) != model.redDofs.n_elem || setup(3) != model.dofsPerNode \
+       || setup(4) != assembly.strategy || setup(5) != assembly.nParts \
+       || setup(6) != assembly.tangentOperator || setup(7) != solver.method \
+       || ( setup(8) > 0 ) != halfStored \
+       || ( nodeOrdering > 0 ) != ( nodePerm->nnz > 0 ) ){
+    throw runtime_error( "sessionSetup: the checkpoint is of another model or settings" ) ;
+  }
+
+  assembly.elemFunders = checkpointMat ( checkpoint, "elemFunders" ) ;
+  assembly.elemVols    = checkpointMat ( checkpoint, "elemVols"    ) ;
+  assembly.colPtrs     = checkpointUmat( checkpoint, "colPtrs"     ) ;
+  assembly.rowInds     = checkpointUmat( checkpoint, "rowInds"     ) ;
+  assembly.elemSlots   = conv_to< Mat<u32> >::from( dataFileUmat( checkpoint, "elemSlots" ) ) ;
+  assembly.colorPtrs   = checkpointUmat( checkpoint, "colorPtrs"   ) ;
+  assembly.colorElems  = checkpointUmat( checkpoint, "colorElems"  ) ;
+  assembly.colorGroups = checkpointUmat( checkpoint, "colorGroups" ) ;
+  assembly.partRanges  = checkpointUmat( checkpoint, "partRanges"  ) ;
+
+  // the symbolic factorization, and the data of the preconditioners
+  if ( solver.method == 1 && setup(9) > 0 ){
+    linearSolverAnalysisRestore( assembly.colPtrs, assembly.rowInds, \
+      dataFileUmat( checkpoint, "ldlBlocks" ), dataFileUmat( checkpoint, "ldlPerm" ), \
+      conv_to<ivec>::from( dataFileVec( checkpoint, "ldlParent" ) ), \
+      dataFileUmat( checkpoint, "ldlLp" ), solver ) ;
+  }
+  if ( solver.method > 0 ){
+    linearSolverSetup( model, assembly, solver ) ;
+  }
+  solver.halfStored = halfStored ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionRestoreState ---
+// =============================================================================
+// values of the step of the checkpoint read by sessionSetup, from which the
+// run continues (ONSAS numbering), and its last tangent matrix, used by the
+// first iteration. Returns false, without changing the values, if there is
+// none. The checkpoint file is closed.
+bool sessionRestoreState( solverSession & session, vec & U, vec & Udot, \
+  vec & Udotdot, double & currLoadFactor, double & nextLoadFactor, \
+  double & currTime, uint & timeIndex ){
+
+  const dataFile & checkpoint = session.restartFile ;
+  if ( checkpoint.map == nullptr ){ return false ; }
+
+  vec step = dataFileVec( checkpoint, "step" ) ;
+  currLoadFactor = step(0) ;
+  nextLoadFactor = step(1) ;
+  currTime       = step(2) ;
+  timeIndex      = step(3) ;
+  U       = checkpointMat( checkpoint, "U"       ) ;
+  Udot    = checkpointMat( checkpoint, "Udot"    ) ;
+  Udotdot = checkpointMat( checkpoint, "Udotdot" ) ;
+
+  solverState & state = session.state ;
+  if ( session.assembly.tangentOperator == 0 ){
+    state.systemDeltauMatrix = dataFileSpMat( checkpoint, "tangent" ) ;
+    if ( state.systemDeltauMatrix.n_rows > 0 ){
+      state.matrixVersion++ ;
+      session.tangentSet = true ;
+    }
+  }
+  dataFileClose( session.restartFile ) ;
+  return true ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionSetTangent ---
+// =============================================================================
+// reduced tangent matrix given by ONSAS (free dofs in the order of neumdofs),
+// used by the first iteration of the next time step instead of the one kept
+// by the session. Ignored by the matrix-free tangent operators.
+void sessionSetTangent( const sp_mat & onsasMatrix, solverSession & session ){
+
+  solverState & state = session.state ;
+  if ( session.assembly.tangentOperator > 0 ){ return ; }
+
+  state.systemDeltauMatrix = onsasMatrix ;
+  reducedMatrixOnsasToModel( session.model, state.systemDeltauMatrix ) ;
+  if ( state.linearSolver.halfStored ){
+    fullToHalfStorage( state.linearSolver.permInv, state.systemDeltauMatrix ) ;
+  }
+  state.matrixVersion++ ;
+  session.tangentSet = true ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionTangent ---
+// =============================================================================
+// last tangent matrix of the session, with all the entries and in the ONSAS
+// numbering, empty for the matrix-free tangent operators
+void sessionTangent( const solverSession & session, sp_mat & onsasMatrix ){
+
+  if ( session.assembly.tangentOperator > 0 ){ onsasMatrix.reset() ;  return ; }
+
+  if ( session.state.linearSolver.halfStored ){
+    halfToFullStorage( session.state.systemDeltauMatrix, onsasMatrix ) ;
+  }else{
+    onsasMatrix = session.state.systemDeltauMatrix ;
+  }
+  reducedMatrixModelToOnsas( session.model, onsasMatrix ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- sessionTimeStep ---
+// =============================================================================
+// iteration in displacements or load-displacements of one time step, from
+// the converged values U, Udot and Udotdot at time currTime (ONSAS
+// numbering, Udot and Udotdot may be empty for zero). The first iteration
+// uses the tangent matrix set by sessionSetTangent or kept from the previous
+// step, or assembles it if there is none or if the tangent policy 1 takes
+// the one of the first iteration of each step. Returns the values at t and t+1
+// in the ONSAS numbering and auxOutValsVec = { nextTime, stopCritPar,
+// dispIters, solutionMethod }.
+void sessionTimeStep( const vec & U, const vec & Udot, const vec & Udotdot, \
+  double currLoadFactor, double nextLoadFactor, double currTime, uint timeIndex, \
+  solverSession & session, vec & Ut, vec & Utp1, vec & Udottp1, vec & Udotdottp1, \
+  vec & auxOutValsVec ){
+
+  const modelData    & model    = session.model    ;
+  const assemblyData & assembly = session.assembly ;
+  solverState        & state    = session.state    ;
+
+  uint solutionMethod, nLoadSteps, stopTolIts ;
+  double stopTolDeltau, stopTolForces, targetLoadFactr, \
+    incremArcLen, deltaT, deltaNW, AlphaNW, alphaHHT, finalTime ;
+  extractMethodParams( model.numericalMethodParams, solutionMethod, stopTolDeltau, \
+    stopTolForces, stopTolIts, targetLoadFactr, nLoadSteps, incremArcLen, \
+    deltaT, deltaNW, AlphaNW, alphaHHT, finalTime );
+
+  state.currLoadFactor = currLoadFactor ;
+  state.nextLoadFactor = nextLoadFactor ;
+  state.currTime       = currTime ;
+  state.timeIndex      = timeIndex ;
+
+  dofsOnsasToModel( model, U, state.Ut ) ;
+  if ( Udot.n_elem    > 0 ){ dofsOnsasToModel( model, Udot   , state.Udott    ) ; }
+  else{ state.Udott.zeros( state.Ut.n_elem ) ; }
+  if ( Udotdot.n_elem > 0 ){ dofsOnsasToModel( model, Udotdot, state.Udotdott ) ; }
+  else{ state.Udotdott.zeros( state.Ut.n_elem ) ; }
+
+  state.Utp1k = state.Ut ; // initial guess displacements
+  // initial guess velocities and accelerations
+
+  updateTime( model, state ) ;
+
+  uint tangentPolicy ;  double tangentParam ;
+  extractTangentPolicy( model.numericalMethodParams, tangentPolicy, tangentParam ) ;
+  bool stepTangent = tangentPolicy == 1 && !session.tangentSet ;
+  session.tangentSet = false ;
+
+  // the quasi-Newton corrections belong to the tangent of one step
+  state.qnPairs = 0 ;  state.qnNext = 0 ;
+
+  // --- compute RHS for initial guess, and the matrix-free tangent or the
+  //     tangent matrix when none was given ---
+  if ( assembly.tangentOperator > 0 || state.systemDeltauMatrix.n_rows == 0 || stepTangent ){
+    computeRHSAndMatrix( model, assembly, state ) ;
+  }else{
+    computeRHS( model, assembly, state ) ;
+  }
+  // ---------------------------------------------------
+
+  bool booleanConverged = 0 ;
+  uint dispIters        = 0 ;
+  uint stopCritPar      = 0 ;
+  double deltaErrLoad   = 0 ;
+  vec  currDeltau( model.neumdofs.n_elem , fill::zeros ) ;
+
+  while (booleanConverged == 0){
+
+    dispIters++;
+
+    // --- solve system ---
+    computeDeltaU ( model, assembly, dispIters, currDeltau, state ) ;
+    // ---------------------------------------------------
+
+    // --- updates: model variables and computes internal forces ---
+    updateUiter( state.deltaured, model.redDofs, solutionMethod, state.Utp1k ) ;
+    // ---------------------------------------------------
+
+    // --- update next time magnitudes ---
+    updateTime( model, state ) ;
+    // ---------------------------------------------------
+
+    // --- new rhs and, as set by the tangent policy, system matrix ---
+    computeIterationSystem( model, assembly, dispIters, state ) ;
+    // ---------------------------------------------------
+
+    // --- check convergence ---
+    convergenceTest( model, state, dispIters, booleanConverged, stopCritPar, deltaErrLoad ) ;
+    // ---------------------------------------------------
+
+    // --- prints iteration info ---
+    printSolverOutput( session.log, state.timeIndex+1, { 1, double( dispIters ), \
+      deltaErrLoad, norm( state.deltaured ), state.nextLoadFactor } ) ;
+  }
+  printSolverOutput( session.log, state.timeIndex+1, { 2, state.nextLoadFactor, \
+    double( dispIters ), double( stopCritPar ), 0, 0 } ) ;
+  // --------------------------------------------------------------------
+
+  // results in the ONSAS numbering
+  dofsModelToOnsas( model, state.Ut         , Ut         ) ;
+  dofsModelToOnsas( model, state.Utp1k      , Utp1       ) ;
+  dofsModelToOnsas( model, state.Udottp1k   , Udottp1    ) ;
+  dofsModelToOnsas( model, state.Udotdottp1k, Udotdottp1 ) ;
+
+  auxOutValsVec = { state.nextTime, double( stopCritPar ), double( dispIters ), double( solutionMethod ) } ;
+}
+// =============================================================================
@@ -0,0 +1,718 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "onsaspp.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace std  ;
+using namespace arma ;
+
+// =============================================================================
+// --- extractMethodParams ---
+// =============================================================================
+void extractMethodParams( const vec & numericalMethodParams, uint & solutionMethod, \
+                          double & stopTolDeltau, double & stopTolForces,  \
+                          uint & stopTolIts, double & targetLoadFactr, \
+                          uint & nLoadSteps, double & incremArcLen, \
+                          double & deltaT, double & deltaNW, double & AlphaNW, \
+                          double & alphaHHT, double & finalTime ){
+  
+  solutionMethod   = numericalMethodParams(1-1) ;
+  
+  if (solutionMethod == 1){
+
+    // ----- resolution method params -----
+    stopTolDeltau    = numericalMethodParams(2-1) ;
+    stopTolForces    = numericalMethodParams(3-1) ;
+    stopTolIts       = numericalMethodParams(4-1) ;
+    targetLoadFactr  = numericalMethodParams(5-1) ;
+    nLoadSteps       = numericalMethodParams(6-1) ;
+  
+    incremArcLen     = 0 ;
+   
+    deltaT = targetLoadFactr / double( nLoadSteps) ;
+    
+    finalTime = targetLoadFactr ;
+    
+    deltaNW =  0; AlphaNW = 0 ; alphaHHT = 0 ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- extractTangentPolicy ---
+// =============================================================================
+// update of the tangent matrix along the Newton iterations, given by the
+// optional entries 7 and 8 of numericalMethodParams [defaults]:
+//   7: tangentPolicy                                                      [0]
+//      0: full Newton, tangent matrix of each iterate
+//      1: modified Newton, tangent matrix of the first iteration of the step
+//      2: modified Newton, tangent matrix kept from the previous steps
+//      3: tangent matrix updated every tangentParam iterations
+//      4: tangent matrix updated when the ratio of the norms of consecutive
+//         residuals is above tangentParam
+//      5: quasi-Newton, L-BFGS corrections to the factorization of the first
+//         iteration from the last tangentParam pairs (see computeDeltaU)
+//   8: tangentParam                               [3 for 3, 0.5 for 4, 5 for 5]
+void extractTangentPolicy( const vec & numericalMethodParams, uint & tangentPolicy, \
+                           double & tangentParam ){
+
+  tangentPolicy = 0 ;
+  if ( numericalMethodParams.n_elem >= 7 ){ tangentPolicy = numericalMethodParams(7-1) ; }
+
+  tangentParam = ( tangentPolicy == 4 ) ? 0.5 : ( tangentPolicy == 5 ) ? 5 : 3 ;
+  if ( numericalMethodParams.n_elem >= 8 ){ tangentParam = numericalMethodParams(8-1) ; }
+  if ( ( tangentPolicy == 3 || tangentPolicy == 5 ) && tangentParam < 1 ){ tangentParam = 1 ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- extractCppSolverParams ---
+// =============================================================================
+// settings of the C++ implementation, given in the optional vector file
+// cppSolverParams.dat. Missing entries take the default value in brackets.
+//   1: assembly strategy: 0 serial, 1 element coloring, 2 partial buffers [1]
+//   2: number of element parts used by the partial buffers strategy      [8]
+//   3: SVK tetrahedra computed in batches by elementTetraSVKBatch (1/0)  [1]
+//   4: 3 dofs per node for solid models, see computeDofsNumbering (1/0) [1]
+//   5: linear solver: 0 spsolve, 1 LDL' with reused analysis, 2 conjugate
+//      gradients, 3 MINRES                                               [1]
+//   6: preconditioner of 2 and 3: 0 none, 1 Jacobi of the node blocks,
+//      2 smoothed aggregation multigrid                                  [2]
+//   7: relative tolerance of 2 and 3, 0 for Eisenstat-Walker forcing terms [0]
+//   8: maximum number of iterations of 2 and 3                        [1000]
+//   9: tangent operator: 0 assembled matrix, matrix-free element by element
+//      products with 1 stored or 2 recomputed element matrices, solved by
+//      2 or 3 (conjugate gradients when 0 or 1 is given)                  [0]
+//  10: renumbering of the nodes at load time, see renumberModel: 0 none,
+//      1 reverse Cuthill-McKee, 2 minimum degree, 3 nested dissection     [0]
+//  11: symmetric tangent matrices of the LDL' solver assembled and stored
+//      with one entry of each symmetric pair, see computeHalfPattern (1/0) [1]
+//  12: time steps solved by timeStepIteration: 0 the one of the input files,
+//      1 all the steps from it to nLoadSteps, see numericalMethodParams     [0]
+//  13: interval of the time steps with results written by the multi-step
+//      run, the last step is always written                              [1]
+//  14: tangent matrix files, for debugging: 1 reads systemDeltauMatrix for
+//      the first iteration and writes systemDeltauMatrixCpp, 0 assembles it
+//      or keeps it in memory between the steps of a run                   [0]
+//  15: interval of the time steps with a checkpoint of the session written
+//      to checkpoint.bin, see sessionCheckpoint, 0 for none               [0]
+//  16: restart from checkpoint.bin (1/0), see sessionSetup                [0]
+//  17: interval of the time steps with displacements written to the XDMF
+//      results of the run, see resultsWriterOpen, 0 for none              [0]
+//  18: second Piola-Kirchhoff stresses of the tetrahedra also written to
+//      the XDMF results (1/0)                                             [0]
+//  19: console output: 0 none, 1 a line per time step, 2 also a line per
+//      iteration, see printSolverOutput                                   [2]
+//  20: increments log file <outputDir><problemName>_incrementsOutput: 0
+//      none, 1 .csv, 2 .jsonl (JSON lines), see solverLogFlush             [1]
+void extractCppSolverParams( const vec & cppSolverParams, uint & assemblyStrategy, \
+                             uint & nAssemblyParts, uint & batchedKernel, \
+                             uint & compactDofs, uint & linearSolverMethod, \
+                             uint & preconditioner, double & linearRelTol, \
+                             uint & linearMaxIts, uint & tangentOperator, \
+                             uint & nodeOrdering, uint & symmetricStorage, \
+                             uint & loadSteps, uint & outputInterval, \
+                             uint & tangentFiles, uint & checkpointInterval, \
+                             uint & restart, uint & resultsInterval, \
+                             uint & resultsStresses, uint & verbosity, \
+                             uint & logFormat ){
+
+  assemblyStrategy = 1 ;
+  nAssemblyParts   = 8 ;
+  batchedKernel    = 1 ;
+  compactDofs      = 1 ;
+  linearSolverMethod = 1 ;
+  preconditioner   = 2 ;
+  linearRelTol     = 0 ;
+  linearMaxIts     = 1000 ;
+  tangentOperator  = 0 ;
+  nodeOrdering     = 0 ;
+  symmetricStorage = 1 ;
+  loadSteps        = 0 ;
+  outputInterval   = 1 ;
+  tangentFiles     = 0 ;
+  checkpointInterval = 0 ;
+  restart          = 0 ;
+  resultsInterval  = 0 ;
+  resultsStresses  = 0 ;
+  verbosity        = 2 ;
+  logFormat        = 1 ;
+
+  if ( cppSolverParams.n_elem >= 1 ){ assemblyStrategy = cppSolverParams(1-1) ; }
+  if ( cppSolverParams.n_elem >= 2 ){ nAssemblyParts   = cppSolverParams(2-1) ; }
+  if ( cppSolverParams.n_elem >= 3 ){ batchedKernel    = cppSolverParams(3-1) ; }
+  if ( cppSolverParams.n_elem >= 4 ){ compactDofs      = cppSolverParams(4-1) ; }
+  if ( cppSolverParams.n_elem >= 5 ){ linearSolverMethod = cppSolverParams(5-1) ; }
+  if ( cppSolverParams.n_elem >= 6 ){ preconditioner   = cppSolverParams(6-1) ; }
+  if ( cppSolverParams.n_elem >= 7 ){ linearRelTol     = cppSolverParams(7-1) ; }
+  if ( cppSolverParams.n_elem >= 8 ){ linearMaxIts     = cppSolverParams(8-1) ; }
+  if ( cppSolverParams.n_elem >= 9 ){ tangentOperator  = cppSolverParams(9-1) ; }
+  if ( cppSolverParams.n_elem >= 10 ){ nodeOrdering    = cppSolverParams(10-1) ; }
+  if ( cppSolverParams.n_elem >= 11 ){ symmetricStorage = cppSolverParams(11-1) ; }
+  if ( cppSolverParams.n_elem >= 12 ){ loadSteps       = cppSolverParams(12-1) ; }
+  if ( cppSolverParams.n_elem >= 13 ){ outputInterval  = cppSolverParams(13-1) ; }
+  if ( cppSolverParams.n_elem >= 14 ){ tangentFiles    = cppSolverParams(14-1) ; }
+  if ( cppSolverParams.n_elem >= 15 ){ checkpointInterval = cppSolverParams(15-1) ; }
+  if ( cppSolverParams.n_elem >= 16 ){ restart         = cppSolverParams(16-1) ; }
+  if ( cppSolverParams.n_elem >= 17 ){ resultsInterval = cppSolverParams(17-1) ; }
+  if ( cppSolverParams.n_elem >= 18 ){ resultsStresses = cppSolverParams(18-1) ; }
+  if ( cppSolverParams.n_elem >= 19 ){ verbosity       = cppSolverParams(19-1) ; }
+  if ( cppSolverParams.n_elem >= 20 ){ logFormat       = cppSolverParams(20-1) ; }
+
+  if ( nAssemblyParts < 1 ){ nAssemblyParts = 1 ; }
+  if ( outputInterval < 1 ){ outputInterval = 1 ; }
+  if ( tangentOperator > 0 && linearSolverMethod < 2 ){ linearSolverMethod = 2 ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- computeFext ---
+// =============================================================================
+void computeFext( const modelData & model, double nextLoadFactor, vec & FextG ){
+  
+  FextG  = model.variableFext * nextLoadFactor + model.constantFext  ;//+ FextUser  ;
+}
+// =============================================================================
+
+
+
+
+
+
+
+// =============================================================================
+// --- computeRHSFromForces ---
+// =============================================================================
+// reduced residual from already assembled internal forces
+void computeRHSFromForces( const modelData & model, const field<vec> & fs, \
+    double nextLoadFactor, vec & systemDeltauRHS, vec & FextG ){
+
+  const vec & Fint = fs(0,0) ;
+
+  computeFext( model, nextLoadFactor, FextG ) ;
+
+  const uvec & redDofs = model.redDofs ;
+  systemDeltauRHS.set_size( redDofs.n_elem ) ;
+  for ( uword i=0; i < redDofs.n_elem; i++){
+    systemDeltauRHS( i ) = - ( Fint( redDofs( i ) ) - FextG( redDofs( i ) ) ) ;
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// --- computeRHS ---
+// =============================================================================
+// residual at the iterate state.Utp1k
+void computeRHS( const modelData & model, const assemblyData & assembly, \
+    solverState & state ){
+  
+  assembler ( model, assembly, state.Utp1k, state.Udottp1k, state.Udotdottp1k, \
+    1, state.fs, state.ks ) ;
+
+  computeRHSFromForces( model, state.fs, state.nextLoadFactor, \
+    state.systemDeltauRHS, state.FextG ) ;
+}
+// =============================================================================
+
+
+
+// =============================================================================
+//  updateTime
+// =============================================================================
+void updateTime( const modelData & model, solverState & state ){
+      
+  uint solutionMethod, stopTolIts, nLoadSteps;
+  double stopTolDeltau, stopTolForces, targetLoadFactr, incremArcLen, deltaT, \
+    deltaNW, AlphaNW, alphaHHT, finalTime;
+  
+  extractMethodParams( model.numericalMethodParams, solutionMethod, stopTolDeltau, \
+                       stopTolForces, stopTolIts, targetLoadFactr, nLoadSteps, \
+		       incremArcLen, deltaT, deltaNW, AlphaNW, alphaHHT, finalTime );
+
+  state.nextTime    = state.currTime + deltaT ;
+  state.Udotdottp1k = state.Udotdott          ;
+  state.Udottp1k    = state.Udott             ;
+}
+// =============================================================================
+
+
+
+
+
+
+
+
+
+// =============================================================================
+// adds the reduced increment deltaured to the free dofs of Utp1k, in place
+void updateUiter( const vec & deltaured, const uvec & redDofs, \
+  uint solutionMethod, vec & Utp1k ){
+  for ( uint i=1; i<= redDofs.n_elem; i++){
+    Utp1k( redDofs(i-1) ) = Utp1k( redDofs(i-1) ) + deltaured( i-1) ;
+  }
+}
+// =============================================================================
+
+
+
+
+
+
+// =============================================================================
+//  computeForcingTerm
+// =============================================================================
+// relative tolerance of the iterative linear solvers for the system of
+// iteration dispIter (inexact Newton). Unless a fixed tolerance is given, it
+// is the Eisenstat-Walker forcing term ( choice 2, gamma 0.9, alpha 2 ):
+// eta = gamma ( |r_k| / |r_k-1| )^alpha, safeguarded from decreasing too fast
+// and kept above the tolerance needed by the forces convergence criterion.
+void computeForcingTerm( const modelData & model, uint dispIter, solverState & state ){
+
+  linearSolverData & solver = state.linearSolver ;
+  const double gamma = 0.9, alpha = 2, etaMax = 0.5 ;
+
+  double normRHS = norm( state.systemDeltauRHS ) ;
+
+  if ( solver.relTol > 0 ){
+    solver.forcingTerm = solver.relTol ;
+  }else if ( dispIter == 1 || solver.prevNormRHS == 0 ){
+    solver.forcingTerm = etaMax ;
+  }else{
+    double eta = gamma * pow( normRHS / solver.prevNormRHS, alpha ) ;
+    double etaSafe = gamma * pow( solver.forcingTerm, alpha ) ;
+    if ( etaSafe > 0.1 ){ eta = max( eta, etaSafe ) ; }
+
+    uint solutionMethod, stopTolIts, nLoadSteps ;
+    double stopTolDeltau, stopTolForces, targetLoadFactr, incremArcLen, deltaT, \
+      deltaNW, AlphaNW, alphaHHT, finalTime ;
+    extractMethodParams( model.numericalMethodParams, solutionMethod, stopTolDeltau, \
+      stopTolForces, stopTolIts, targetLoadFactr, nLoadSteps, incremArcLen, \
+      deltaT, deltaNW, AlphaNW, alphaHHT, finalTime );
+
+    double normFext = 0 ;
+    for ( uword i=0; i < model.redDofs.n_elem; i++){
+      normFext += state.FextG( model.redDofs( i ) ) * state.FextG( model.redDofs( i ) ) ;
+    }
+    normFext = sqrt( normFext ) ;
+    double tolForces = ( normFext + ( normFext < stopTolForces ) ) * stopTolForces ;
+    if ( normRHS > 0 ){ eta = max( eta, 0.5 * tolForces / normRHS ) ; }
+
+    solver.forcingTerm = min( eta, etaMax ) ;
+  }
+  solver.prevNormRHS = normRHS ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// solves systemDeltauMatrix x = rhs. The LDL' factorization of the linear
+// solver, or the preconditioner of the iterative methods, is reused while
+// state.matrixVersion does not change; spsolve is used when it is selected
+// or the other methods fail. The matrix-free tangent is only solved by the
+// iterative methods: by MINRES when conjugate gradients fail (indefinite
+// tangents), and state.linearSolveFailed is set when it also fails.
+void solveTangentSystem( const modelData & model, const assemblyData & assembly, \
+  const vec & rhs, solverState & state, vec & x ){
+
+  linearSolverData & solver = state.linearSolver ;
+  state.linearSolveFailed = false ;
+  if ( assembly.tangentOperator > 0 ){
+    bool solved = matrixFreeSolve( model, assembly, state.Utangent, state.elemTangents, \
+      state.matrixVersion, rhs, solver.forcingTerm, solver, x ) ;
+    if ( !solved && solver.method == 2 ){
+      solver.method = 3 ;
+      solved = matrixFreeSolve( model, assembly, state.Utangent, state.elemTangents, \
+        state.matrixVersion, rhs, solver.forcingTerm, solver, x ) ;
+      solver.method = 2 ;
+    }
+    state.linearSolveFailed = !solved ;
+    return ;
+  }
+  if ( solver.method == 1 \
+       && linearSolverSolve( state.systemDeltauMatrix, state.matrixVersion, \
+            rhs, solver, x ) ){
+    return ;
+  }
+  if ( ( solver.method == 2 || solver.method == 3 ) \
+       && iterativeSolverSolve( state.systemDeltauMatrix, state.matrixVersion, \
+            rhs, solver.forcingTerm, solver, x ) ){
+    return ;
+  }
+  if ( solver.halfStored ){
+    sp_mat fullMatrix ;
+    halfToFullStorage( state.systemDeltauMatrix, fullMatrix ) ;
+    x = spsolve( fullMatrix, rhs );
+  }else{
+    x = spsolve( state.systemDeltauMatrix, rhs );
+  }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// increment of the iteration. With the quasi-Newton policy the inverse of the
+// matrix is corrected by the stored pairs (L-BFGS two loop recursion, newest
+// pair first), otherwise it is the solution of the system of the iteration.
+void computeDeltaU( const modelData & model, const assemblyData & assembly, \
+  uint dispIter, const vec & currDeltau, solverState & state ){
+
+  uint tangentPolicy ;  double tangentParam ;
+  extractTangentPolicy( model.numericalMethodParams, tangentPolicy, tangentParam ) ;
+
+  if ( state.linearSolver.method == 2 || state.linearSolver.method == 3 ){
+    computeForcingTerm( model, dispIter, state ) ;
+  }
+
+  if ( tangentPolicy != 5 || state.qnPairs == 0 ){
+    solveTangentSystem( model, assembly, state.systemDeltauRHS, state, state.deltaured ) ;
+    return ;
+  }
+
+  uword m = state.qnSteps.n_cols ;
+  vec q = state.systemDeltauRHS ;
+  vec alpha( state.qnPairs ) ;
+  for ( uword j=0; j < state.qnPairs; j++){
+    uword c = ( state.qnNext + m - 1 - j ) % m ;
+    alpha( j ) = state.qnRho( c ) * dot( state.qnSteps.col( c ), q ) ;
+    q -= alpha( j ) * state.qnResChanges.col( c ) ;
+  }
+
+  solveTangentSystem( model, assembly, q, state, state.deltaured ) ;
+
+  for ( uword j=state.qnPairs; j-- > 0; ){
+    uword c = ( state.qnNext + m - 1 - j ) % m ;
+    double beta = state.qnRho( c ) * dot( state.qnResChanges.col( c ), state.deltaured ) ;
+    state.deltaured += ( alpha( j ) - beta ) * state.qnSteps.col( c ) ;
+  }
+}
+// =============================================================================
+
+
+// =============================================================================
+//  computeMatrixFree
+// =============================================================================
+// matrix-free tangent at the iterate state.Utp1k, and the internal forces:
+// the element matrices (tangentOperator 1) or the iterate (2)
+void computeMatrixFree( const modelData & model, const assemblyData & assembly, \
+  solverState & state ){
+
+  if ( assembly.tangentOperator == 1 ){
+    computeElemTangents( model, assembly, state.Utp1k, state.fs, state.elemTangents ) ;
+  }else{
+    assembler( model, assembly, state.Utp1k, state.Udottp1k, state.Udotdottp1k, \
+      1, state.fs, state.ks ) ;
+    state.Utangent = state.Utp1k ;
+  }
+  state.matrixVersion++ ;
+}
+// =============================================================================
+
+
+// =============================================================================
+//  compute matrix
+// =============================================================================
+// tangent matrix at the iterate state.Utp1k
+void computeMatrix( const modelData & model, const assemblyData & assembly, \
+  solverState & state ){
+
+  if ( assembly.tangentOperator > 0 ){
+    computeMatrixFree( model, assembly, state ) ;
+    return ;
+  }
+
+  // computes static tangent matrix
+  assembler( model, assembly, state.Utp1k, state.Udottp1k, state.Udotdottp1k, \
+    2, state.fs, state.ks ) ;
+    
+  state.systemDeltauMatrix = std::move( state.ks(0,0) ) ;
+  state.matrixVersion++ ;
+}
+// =============================================================================
+
+
+
+
+
+
+// =============================================================================
+//  computeRHSAndMatrix
+// =============================================================================
+// residual and tangent matrix at Utp1 from a single assembler pass: paramOut 2
+// also returns the internal forces, so the elements are evaluated only once
+void computeRHSAndMatrix( const modelData & model, \
+    const assemblyData & assembly, solverState & state ){
+
+  if ( assembly.tangentOperator > 0 ){
+    computeMatrixFree( model, assembly, state ) ;
+  }else{
+    assembler( model, assembly, state.Utp1k, state.Udottp1k, state.Udotdottp1k, \
+      2, state.fs, state.ks ) ;
+
+    state.systemDeltauMatrix = std::move( state.ks(0,0) ) ;
+    state.matrixVersion++ ;
+  }
+
+  computeRHSFromForces( model, state.fs, state.nextLoadFactor, \
+    state.systemDeltauRHS, state.FextG ) ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+//  computeIterationSystem
+// =============================================================================
+// residual at the iterate of Newton iteration dispIter and, when the tangent
+// policy requires it (see extractTangentPolicy), the tangent matrix used by
+// the next iteration. Otherwise the matrix, and its factorization by the
+// linear solver, are kept and only the internal forces are assembled.
+void computeIterationSystem( const modelData & model, const assemblyData & assembly, \
+    uint dispIter, solverState & state ){
+
+  uint tangentPolicy ;  double tangentParam ;
+  extractTangentPolicy( model.numericalMethodParams, tangentPolicy, tangentParam ) ;
+
+  if ( tangentPolicy == 0 \
+       || ( tangentPolicy == 3 && dispIter % uint( tangentParam ) == 0 ) ){
+    computeRHSAndMatrix( model, assembly, state ) ;
+    return ;
+  }
+
+  // quasi-Newton pair: increment and change of the residual
+  uword m = uword( tangentParam ), n = state.systemDeltauRHS.n_elem ;
+  vec resChange ;
+  if ( tangentPolicy == 5 ){
+    if ( state.qnSteps.n_cols != m || state.qnSteps.n_rows != n ){
+      state.qnSteps.set_size( n, m ) ;  state.qnResChanges.set_size( n, m ) ;
+      state.qnRho.set_size( m ) ;  state.qnPairs = 0 ;  state.qnNext = 0 ;
+    }
+    resChange = state.systemDeltauRHS ;
+  }
+
+  double prevNormRHS = norm( state.systemDeltauRHS ) ;
+  computeRHS( model, assembly, state ) ;
+  double normRHS = norm( state.systemDeltauRHS ) ;
+
+  if ( tangentPolicy == 4 && normRHS > tangentParam * prevNormRHS ){
+    computeMatrix( model, assembly, state ) ;
+  }
+
+  if ( tangentPolicy == 5 ){
+    if ( normRHS > prevNormRHS ){
+      computeMatrix( model, assembly, state ) ;
+      state.qnPairs = 0 ;
+      return ;
+    }
+    // pairs without positive curvature are not stored, the slot of the
+    // oldest pair is only overwritten by an accepted one
+    uword c = state.qnNext ;
+    resChange -= state.systemDeltauRHS ;
+    double ys = dot( resChange, state.deltaured ) ;
+    if ( ys > 1e-12 * norm( resChange ) * norm( state.deltaured ) ){
+      state.qnResChanges.col( c ) = resChange ;
+      state.qnSteps.col( c ) = state.deltaured ;
+      state.qnRho( c ) = 1.0 / ys ;
+      state.qnNext  = ( c + 1 ) % m ;
+      state.qnPairs = min( state.qnPairs + 1, uint( m ) ) ;
+    }
+  }
+}
+// =============================================================================
+
+
+
+
+
+
+// convergence of the Newton iteration, from the reduced (free dofs) entries
+// of the external forces and of the iterate state.Utp1k
+void  convergenceTest( const modelData & model, const solverState & state, \
+  uint dispIters, bool & booleanConverged, uint & stopCritPar, \
+  double & deltaErrLoad ){
+
+  uint solutionMethod, nLoadSteps, stopTolIts ;
+  double stopTolDeltau, stopTolForces, targetLoadFactr, \
+    incremArcLen, deltaT, deltaNW, AlphaNW, alphaHHT, finalTime ;  
+
+  extractMethodParams( model.numericalMethodParams, solutionMethod, stopTolDeltau, \
+    stopTolForces, stopTolIts, targetLoadFactr, nLoadSteps, incremArcLen, \
+    deltaT, deltaNW, AlphaNW, alphaHHT, finalTime );
+
+  double normaUk = 0, normFext = 0 ;
+  for ( uword i=0; i < model.redDofs.n_elem; i++){
+    normaUk  += state.Utp1k( model.redDofs( i ) ) * state.Utp1k( model.redDofs( i ) ) ;
+    normFext += state.FextG( model.redDofs( i ) ) * state.FextG( model.redDofs( i ) ) ;
+  }
+  normaUk  = sqrt( normaUk  ) ;
+  normFext = sqrt( normFext ) ;
+
+  double normadeltau = norm( state.deltaured )   ;
+  // deltaErrLoad  = norm( redFint - redFext - redFinet )   ;
+
+  deltaErrLoad    = norm( state.systemDeltauRHS ) ;
+  
+  // an increment that does not solve the system is no displacement criterion
+  bool logicDispStop = ( normadeltau  < ( normaUk  * stopTolDeltau ) ) && !state.linearSolveFailed ;
+  bool logicForcStop = ( deltaErrLoad < ( (normFext+(normFext < stopTolForces)) * stopTolForces ) )  && ( deltaErrLoad > 0 ) ;
+   
+  if ( logicForcStop ){
+    stopCritPar = 1 ;      booleanConverged = 1 ;
+  }else if ( logicDispStop ){
+    stopCritPar = 2 ;      booleanConverged = 1 ;
+  }else if ( dispIters >= stopTolIts ){
+    stopCritPar = 3 ;      booleanConverged = 1 ;
+  }else{
+    stopCritPar = 0 ;      booleanConverged = 0 ; 
+  }
+}
+// =============================================================================
+
+
+
+
+
+// =============================================================================
+//  printSolverOutput
+// =============================================================================
+// records a line of the increments log of the time step timeIndex, with
+// lineData as in ONSAS:
+//   { 1, iteration, norm of the RHS, norm of deltau, load factor } for each
+//       iteration
+//   { 2, load factor, iterations, stop criterion, npos, nneg } at the end of
+//       the step
+// The records are kept in the ring buffer of log, appended to the log file
+// when it is full (see solverLogFlush), and printed as set by log.verbosity.
+void printSolverOutput( solverLog & log, uint timeIndex, const vec & lineData ){
+
+  solverLogRecord record ;
+  record.type      = lineData(1-1) ;
+  record.timeIndex = timeIndex ;
+  if ( record.type == 1 ){
+    record.iters      = lineData(2-1) ;
+    record.normRHS    = lineData(3-1) ;
+    record.normDeltau = lineData(4-1) ;
+    record.loadFactor = lineData.n_elem >= 5 ? lineData(5-1) : 0 ;
+    if ( log.verbosity >= 2 ){
+      cout << "iter: " << record.iters << " | norma RHS: " << record.normRHS \
+           << " | norma delta u " << record.normDeltau << '\n' ;
+    }
+  }else{
+    record.loadFactor = lineData(2-1) ;
+    record.iters      = lineData(3-1) ;
+    record.stopCrit   = lineData(4-1) ;
+    if ( log.verbosity >= 1 ){
+      cout << "step: " << timeIndex << " | load factor: " << record.loadFactor \
+           << " | iters: " << record.iters << " | stop criterion: " << record.stopCrit << '\n' ;
+    }
+  }
+
+  if ( log.path.empty() ){ return ; }
+
+  if ( log.records.empty() ){ log.records.resize( solverLogCapacity ) ; }
+  log.records[ ( log.first + log.count ) % log.records.size() ] = record ;
+  log.count++ ;
+  if ( log.count == log.records.size() ){ solverLogFlush( log ) ; }
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+// value for a JSON line, in buffer, or null when it is not finite: JSON has
+// no inf or nan
+static const char * jsonNumber( double value, char * buffer, size_t size ){
+  if ( !std::isfinite( value ) ){ return "null" ; }
+  snprintf( buffer, size, "%.10g", value ) ;
+  return buffer ;
+}
+// =============================================================================
+
+
+
+
+// =============================================================================
+//  solverLogFlush
+// =============================================================================
+// appends the records of the ring buffer of log to the log file, as CSV
+// (log.format 1, with a header line) or JSON lines (2), and flushes the
+// console. The file is created by the first flush of a run that starts at
+// the first time step (index 2, the initial state is 1). Otherwise it is
+// appended to, as by the runs called by ONSAS for each step. onsasppConvert
+// writes LaTeX tables from the CSV file.
+void solverLogFlush( solverLog & log ){
+
+  cout.flush() ;
+  if ( log.path.empty() || log.count == 0 ){ return ; }
+
+  bool append = log.started || log.records[ log.first ].timeIndex > 2 ;
+  bool header = log.format == 1 ;
+  if ( append ){
+    FILE * exists = fopen( log.path.c_str(), "r" ) ;
+    if ( exists != nullptr ){ header = false ;  fclose( exists ) ; }
+  }
+
+  FILE * file = fopen( log.path.c_str(), append ? "a" : "w" ) ;
+  if ( file == nullptr ){
+    cout << "solverLogFlush: can not write " << log.path << endl ;
+    log.count = 0 ;
+    return ;
+  }
+  if ( header ){
+    fprintf( file, "type,timeIndex,loadFactor,iters,normRHS,normDeltau,stopCrit\n" ) ;
+  }
+  for ( size_t k=0; k < log.count; k++){
+    const solverLogRecord & r = log.records[ ( log.first + k ) % log.records.size() ] ;
+    if ( log.format == 1 ){
+      fprintf( file, "%u,%u,%.10g,%u,%.10g,%.10g,%u\n", r.type, r.timeIndex, \
+        r.loadFactor, r.iters, r.normRHS, r.normDeltau, r.stopCrit ) ;
+    }else{
+      char loadFactor[32], normRHS[32], normDeltau[32] ;
+      fprintf( file, "{\"type\": %u, \"timeIndex\": %u, \"loadFactor\": %s, " \
+        "\"iters\": %u, \"normRHS\": %s, \"normDeltau\": %s, \"stopCrit\": %u}\n", \
+        r.type, r.timeIndex, jsonNumber( r.loadFactor, loadFactor, 32 ), r.iters, \
+        jsonNumber( r.normRHS, normRHS, 32 ), jsonNumber( r.normDeltau, normDeltau, 32 ), \
+        r.stopCrit ) ;
+    }
+  }
+  fclose( file ) ;
+
+  log.first   = ( log.first + log.count ) % log.records.size() ;
+  log.count   = 0 ;
+  log.started = true ;
+}
+// =============================================================================
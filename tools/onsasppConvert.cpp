@@ -0,0 +1,183 @@
+// Copyright (C) 2020, J. M. Perez Zerpa
+//
+// This file is part of ONSAS++.
+//
+// ONSAS++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ONSAS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ONSAS++.  If not, see <https://www.gnu.org/licenses/>.
+
+// converter between the .dat files exchanged with ONSAS and the binary
+// container of dataFile.cpp, in the working directory. Built from src with
+// make convert. Usage:
+//
+//   onsasppConvert.lnx toBinary [ container ]  - the .dat inputs of
+//       timeStepIteration.lnx found, to container (timeStepInput.bin)
+//   onsasppConvert.lnx toAscii [ container ]   - each section of container
+//       (timeStepOutput.bin) to its .dat file
+//   onsasppConvert.lnx toLatex log.csv         - the increments log written by
+//       the solver (see solverLogFlush) to the rows of a LaTeX table, log.tex
+//
+// The .dat files are written with 17 significant digits, so that the values
+// read back are the same doubles. The sparse input matrices are in the
+// 1-based coordinates of the ONSAS files.
+
+#include "onsaspp.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace std  ;
+using namespace arma ;
+
+// dense and sparse inputs of timeStepIteration, and sparse matrices with the
+// 1-based coordinates written by ONSAS
+static const vector<string> denseInputs = { "scalarParams", "Conec", \
+  "numericalMethodParams", "U", "Udot", "Udotdot", "constantFext", "variableFext", \
+  "neumdofs", "materialsParamsMat", "elementsParamsMat", "coordsElemsMat", \
+  "cppSolverParams" } ;
+static const vector<string> sparseInputs = { "systemDeltauMatrix", "KS" } ;
+
+static bool oneBased( const string & name ){
+  return find( sparseInputs.begin(), sparseInputs.end(), name ) != sparseInputs.end() ;
+}
+
+// =============================================================================
+static void writeDense( const string & path, const dataFileSection & section ){
+  FILE * file = fopen( path.c_str(), "w" ) ;
+  if ( file == nullptr ){ throw runtime_error( "onsasppConvert: can not write " + path ) ; }
+  for ( uword i=0; i < section.nRows; i++){
+    for ( uword j=0; j < section.nCols; j++){
+      if ( j > 0 ){ fprintf( file, " " ) ; }
+      if ( section.type == 2 ){
+        fprintf( file, "%llu", (unsigned long long) section.indices[ i + j*section.nRows ] ) ;
+      }else{
+        fprintf( file, "%.17g", section.values[ i + j*section.nRows ] ) ;
+      }
+    }
+    fprintf( file, "\n" ) ;
+  }
+  fclose( file ) ;
+}
+
+// coordinates of the entries, with a zero entry in the last row and column
+// when there is none there, so that the size is kept
+static void writeSparse( const string & path, const dataFileSection & section, uword shift ){
+  FILE * file = fopen( path.c_str(), "w" ) ;
+  if ( file == nullptr ){ throw runtime_error( "onsasppConvert: can not write " + path ) ; }
+  bool lastEntry = false ;
+  for ( uword j=0; j < section.nCols; j++){
+    for ( uword p=section.colPtrs[ j ]; p < section.colPtrs[ j+1 ]; p++){
+      uword i = section.rowInds[ p ] ;
+      fprintf( file, "%llu %llu %.17g\n", (unsigned long long)( i + shift ), \
+        (unsigned long long)( j + shift ), section.values[ p ] ) ;
+      lastEntry = i+1 == section.nRows && j+1 == section.nCols ;
+    }
+  }
+  if ( section.nRows > 0 && section.nCols > 0 && !lastEntry ){
+    fprintf( file, "%llu %llu 0\n", (unsigned long long)( section.nRows - 1 + shift ), \
+      (unsigned long long)( section.nCols - 1 + shift ) ) ;
+  }
+  fclose( file ) ;
+}
+
+// rows of the increments table, as the ONSAS tables: a row per iteration and
+// a row per time step with its load factor, iterations and stop criterion
+static void writeLatex( const string & csvPath ){
+  ifstream csv( csvPath ) ;
+  if ( !csv ){ throw runtime_error( "onsasppConvert: can not read " + csvPath ) ; }
+  string texPath = csvPath.substr( 0, csvPath.find_last_of( '.' ) ) + ".tex" ;
+  FILE * file = fopen( texPath.c_str(), "w" ) ;
+  if ( file == nullptr ){ throw runtime_error( "onsasppConvert: can not write " + texPath ) ; }
+
+  fprintf( file, "$\\#t$ & $\\lambda(t)$ & its & $\\| RHS \\|$ & $\\| \\Delta u \\|$ & flagExit \\\\ \\hline\n\\endhead\n" ) ;
+  string line ;
+  getline( csv, line ) ; // header
+  while ( getline( csv, line ) ){
+    unsigned int type, timeIndex, iters, stopCrit ;
+    double loadFactor, normRHS, normDeltau ;
+    if ( sscanf( line.c_str(), "%u,%u,%lg,%u,%lg,%lg,%u", &type, &timeIndex, &loadFactor, \
+           &iters, &normRHS, &normDeltau, &stopCrit ) != 7 ){ continue ; }
+    if ( type == 1 ){
+      fprintf( file, "     &           & %4u & %9.2e & %9.2e &    \\\\\n", iters, normRHS, normDeltau ) ;
+    }else{
+      fprintf( file, "\\hdashline\n%4u & %9.2e & %4u &           &           & %2u \\\\\n", \
+        timeIndex, loadFactor, iters, stopCrit ) ;
+    }
+  }
+  fclose( file ) ;
+  cout << "onsasppConvert: " << texPath << " written" << endl ;
+}
+// =============================================================================
+
+
+
+// =============================================================================
+int main( int argc, char * argv[] ){
+
+  string command = argc > 1 ? argv[1] : "" ;
+  if ( command != "toBinary" && command != "toAscii" && command != "toLatex" ){
+    cout << "usage: onsasppConvert.lnx toBinary | toAscii [ container ] | toLatex log.csv" << endl ;
+    return 1 ;
+  }
+
+  try {
+    if ( command == "toLatex" ){
+      if ( argc < 3 ){ throw runtime_error( "onsasppConvert: toLatex needs the log file" ) ; }
+      writeLatex( argv[2] ) ;
+
+    }else if ( command == "toBinary" ){
+      string path = argc > 2 ? argv[2] : "timeStepInput.bin" ;
+
+      // the matrices are kept until the container is written
+      vector<mat>    denses ;  denses.reserve( denseInputs.size() ) ;
+      vector<sp_mat> sparses ; sparses.reserve( sparseInputs.size() ) ;
+      dataFile file ;
+      for ( const string & name : denseInputs ){
+        ifstream exists( name + ".dat" ) ;
+        if ( !exists ){ continue ; }
+        denses.emplace_back() ;
+        denses.back().load( name + ".dat", name == "Conec" ? raw_ascii : auto_detect ) ;
+        dataFileAddMat( file, name, denses.back() ) ;
+      }
+      for ( const string & name : sparseInputs ){
+        ifstream exists( name + ".dat" ) ;
+        if ( !exists ){ continue ; }
+        sparses.emplace_back() ;
+        sp_mat & A = sparses.back() ;
+        A.load( name + ".dat", coord_ascii ) ;
+        if ( A.n_rows > 0 ){
+          A = A.tail_rows( A.n_rows-1 ) ;
+          A = A.tail_cols( A.n_cols-1 ) ;
+        }
+        dataFileAddSpMat( file, name, A ) ;
+      }
+      dataFileSave( path, file ) ;
+      cout << "onsasppConvert: " << file.sections.size() << " sections written to " << path << endl ;
+
+    }else{
+      string path = argc > 2 ? argv[2] : "timeStepOutput.bin" ;
+      dataFile file ;
+      if ( !dataFileOpen( path, file ) ){ throw runtime_error( "onsasppConvert: can not read " + path ) ; }
+      for ( const dataFileSection & section : file.sections ){
+        if ( section.type != 1 ){ writeDense( section.name + ".dat", section ) ; }
+        else{ writeSparse( section.name + ".dat", section, oneBased( section.name ) ? 1 : 0 ) ; }
+      }
+      cout << "onsasppConvert: " << file.sections.size() << " sections of " << path << " written" << endl ;
+      dataFileClose( file ) ;
+    }
+  } catch ( const exception & e ) {
+    cout << e.what() << endl ;
+    return 1 ;
+  }
+  return 0 ;
+}
+// =============================================================================